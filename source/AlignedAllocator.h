@@ -0,0 +1,42 @@
+#pragma once
+
+//Standard includes
+#include <cstddef>
+#include <new>
+
+namespace dae
+{
+	// std::allocator that starts every allocation on an Alignment byte boundary, for arrays that are loaded with aligned SIMD loads
+	template<typename T, size_t Alignment>
+	struct AlignedAllocator
+	{
+		using value_type = T;
+
+		template<typename U>
+		struct rebind
+		{
+			using other = AlignedAllocator<U, Alignment>;
+		};
+
+		AlignedAllocator() = default;
+
+		template<typename U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+		T* allocate(size_t amount)
+		{
+			return static_cast<T*>(::operator new(amount * sizeof(T), std::align_val_t{ Alignment }));
+		}
+
+		void deallocate(T* pData, size_t)
+		{
+			::operator delete(pData, std::align_val_t{ Alignment });
+		}
+
+		template<typename U>
+		bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+		template<typename U>
+		bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+	};
+}
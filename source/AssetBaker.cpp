@@ -0,0 +1,204 @@
+// Offline baker for the runtime asset caches, runs headless without opening a window.
+// Usage: AssetBaker <file.obj | name_diffuse.png | folder>...
+// Every OBJ gets a <file>.meshbin next to it. A <name>_diffuse.png is baked together with the <name>_normal.png, <name>_specular.png
+// and <name>_gloss.png next to it into the <name>_diffuse.png.matbin that MaterialTexture loads, in the layout it samples.
+// The Rasterizer then loads those instead of parsing and decoding
+
+//Standard includes
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "DataTypes.h"
+#include "MaterialCache.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "Utils.h"
+
+// Texture decoding needs SDL_image, the CMake build leaves it out when the library isn't installed
+#if !defined(ASSETBAKER_NO_TEXTURES)
+#include "Texture.h"
+#endif
+
+using namespace dae;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	std::string ToLowerCase(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char character) { return char(std::tolower(character)); });
+		return text;
+	}
+
+	std::string GetLowerCaseExtension(const std::filesystem::path& path)
+	{
+		return ToLowerCase(path.extension().string());
+	}
+
+#if !defined(ASSETBAKER_NO_TEXTURES)
+	// The maps of a material sit next to each other and only differ in this suffix, in the order MaterialCache takes them
+	constexpr const char* MaterialMapSuffixes[MaterialCache::AmountOfMaps]{ "_diffuse.png", "_normal.png", "_specular.png", "_gloss.png" };
+
+	bool IsDiffuseMap(const std::filesystem::path& path)
+	{
+		return ToLowerCase(path.filename().string()).ends_with(MaterialMapSuffixes[0]);
+	}
+#endif
+
+	bool BakeMesh(const std::string& filename)
+	{
+		const Clock::time_point start = Clock::now();
+
+		BakedMesh mesh{};
+		if (!Utils::ParseOBJ(filename, mesh.vertices, mesh.indices))
+		{
+			std::cout << "Failed to parse " << filename << "\n";
+			return false;
+		}
+
+		const MeshOptimizer::VertexCacheStatistics parsedStatistics = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+		MeshCache::Optimize(mesh);
+		const MeshOptimizer::VertexCacheStatistics optimizedStatistics = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+		if (!MeshCache::Write(filename, mesh))
+		{
+			std::cout << "Failed to write " << MeshCache::GetCachePath(filename) << "\n";
+			return false;
+		}
+
+		std::cout << "Baked " << filename << ": " << mesh.vertices.size() << " vertices, " << mesh.indices.size() << " indices, "
+			<< mesh.clusters.size() << " clusters (" << MillisecondsSince(start) << " ms)\n";
+		std::cout << "  ACMR " << parsedStatistics.acmr << " -> " << optimizedStatistics.acmr
+			<< ", ATVR " << parsedStatistics.atvr << " -> " << optimizedStatistics.atvr << "\n";
+		return true;
+	}
+
+#if !defined(ASSETBAKER_NO_TEXTURES)
+	// Interleaved, laid out and mipmapped the way MaterialTexture samples it
+	bool BakeMaterial(const std::string& diffusePath)
+	{
+		const Clock::time_point start = Clock::now();
+
+		const std::string stem = diffusePath.substr(0, diffusePath.size() - std::strlen(MaterialMapSuffixes[0]));
+
+		std::string paths[MaterialCache::AmountOfMaps]{};
+		BakedTexture maps[MaterialCache::AmountOfMaps]{};
+		for (int map{}; map < MaterialCache::AmountOfMaps; ++map)
+		{
+			paths[map] = map == 0 ? diffusePath : stem + MaterialMapSuffixes[map];
+			if (!Texture::DecodeFile(paths[map], maps[map]))
+			{
+				std::cout << "Failed to decode " << paths[map] << "\n";
+				return false;
+			}
+		}
+
+		BakedMaterial material{};
+		if (!MaterialCache::Bake(maps, TextureSampling::TexelLayout::Tiled, material))
+		{
+			std::cout << "Failed to bake " << diffusePath << ": a map is empty\n";
+			return false;
+		}
+
+		if (!MaterialCache::Write(paths, material))
+		{
+			std::cout << "Failed to write " << MaterialCache::GetCachePath(diffusePath) << "\n";
+			return false;
+		}
+
+		std::cout << "Baked " << diffusePath << " material: " << material.mipLevels[0].width << "x" << material.mipLevels[0].height << ", "
+			<< material.mipLevels.size() << " mip levels (" << MillisecondsSince(start) << " ms)\n";
+		return true;
+	}
+#endif
+
+	bool IsBakeable(const std::filesystem::path& path)
+	{
+		const std::string extension = GetLowerCaseExtension(path);
+
+#if defined(ASSETBAKER_NO_TEXTURES)
+		return extension == ".obj";
+#else
+		return extension == ".obj" || IsDiffuseMap(path);
+#endif
+	}
+
+	bool BakeFile(const std::filesystem::path& path)
+	{
+#if !defined(ASSETBAKER_NO_TEXTURES)
+		if (IsDiffuseMap(path))
+			return BakeMaterial(path.string());
+#endif
+
+		return BakeMesh(path.string());
+	}
+}
+
+int main(int argc, char* args[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: AssetBaker <file.obj | name_diffuse.png | folder>...\n";
+		return 1;
+	}
+
+	// Folders are baked one level deep, in a fixed order so the output is the same on every run
+	std::vector<std::filesystem::path> files{};
+	int amountOfSkippedFiles{};
+	for (int argument{ 1 }; argument < argc; ++argument)
+	{
+		const std::filesystem::path path{ args[argument] };
+
+		std::error_code error{};
+		if (std::filesystem::is_directory(path, error))
+		{
+			std::vector<std::filesystem::path> folderFiles{};
+			for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(path, error))
+			{
+				if (entry.is_regular_file() && IsBakeable(entry.path()))
+				{
+					folderFiles.push_back(entry.path());
+				}
+			}
+
+			std::sort(folderFiles.begin(), folderFiles.end());
+			files.insert(files.end(), folderFiles.begin(), folderFiles.end());
+		}
+		else if (IsBakeable(path))
+		{
+			files.push_back(path);
+		}
+		else
+		{
+			std::cout << "Skipped " << path.string() << ": not a file this build can bake\n";
+			++amountOfSkippedFiles;
+		}
+	}
+
+	const Clock::time_point start = Clock::now();
+
+	int amountOfFailures{};
+	for (const std::filesystem::path& file : files)
+	{
+		if (!BakeFile(file))
+		{
+			++amountOfFailures;
+		}
+	}
+
+	std::cout << "Baked " << files.size() - amountOfFailures << " of " << files.size() << " assets in " << MillisecondsSince(start) << " ms\n";
+	return amountOfFailures == 0 && amountOfSkippedFiles == 0 ? 0 : 1;
+}
@@ -0,0 +1,378 @@
+#include "Benchmark.h"
+
+//Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+//Project includes
+#include "MeshCache.h"
+#include "TextureSampling.h"
+#include "Utils.h"
+
+namespace dae
+{
+	namespace Benchmark
+	{
+		// The original iostream based parser, same output as Utils::ParseOBJ. Kept as the reference for the loader benchmark
+		static bool ParseOBJStream(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding)
+		{
+			std::ifstream file(filename);
+			if (!file)
+				return false;
+
+			std::vector<Vector3> positions{};
+			std::vector<Vector3> normals{};
+			std::vector<Vector2> UVs{};
+
+			vertices.clear();
+			indices.clear();
+
+			// Face corners that share all three indices share one vertex
+			std::unordered_map<Utils::ObjVertexKey, uint32_t, Utils::ObjVertexKeyHash> vertexLookup{};
+
+			std::string sCommand;
+			// start a while iteration ending when the end of file is reached (ios::eof)
+			while (!file.eof())
+			{
+				//read the first word of the string, use the >> operator (istream::operator>>) 
+				file >> sCommand;
+				//use conditional statements to process the different commands	
+				if (sCommand == "#")
+				{
+					// Ignore Comment
+				}
+				else if (sCommand == "v")
+				{
+					//Vertex
+					float x, y, z;
+					file >> x >> y >> z;
+
+					positions.emplace_back(x, y, z);
+				}
+				else if (sCommand == "vt")
+				{
+					// Vertex TexCoord
+					float u, v;
+					file >> u >> v;
+					UVs.emplace_back(u, 1 - v);
+				}
+				else if (sCommand == "vn")
+				{
+					// Vertex Normal
+					float x, y, z;
+					file >> x >> y >> z;
+
+					normals.emplace_back(x, y, z);
+				}
+				else if (sCommand == "f")
+				{
+					//if a face is read:
+					//construct the 3 vertices, add them to the vertex array
+					//add three indices to the index array
+					//add the material index as attibute to the attribute array
+					//
+					// Faces or triangles
+					uint32_t tempIndices[3];
+					for (size_t iFace = 0; iFace < 3; iFace++)
+					{
+						Vertex vertex{};
+						size_t iPosition{}, iTexCoord{}, iNormal{};
+
+						// OBJ format uses 1-based arrays
+						file >> iPosition;
+						vertex.position = positions[iPosition - 1];
+
+						if ('/' == file.peek())//is next in buffer ==  '/' ?
+						{
+							file.ignore();//read and ignore one element ('/')
+
+							if ('/' != file.peek())
+							{
+								// Optional texture coordinate
+								file >> iTexCoord;
+								vertex.uv = UVs[iTexCoord - 1];
+							}
+
+							if ('/' == file.peek())
+							{
+								file.ignore();
+
+								// Optional vertex normal
+								file >> iNormal;
+								vertex.normal = normals[iNormal - 1];
+							}
+						}
+
+						const auto [it, isNewVertex] = vertexLookup.try_emplace({ iPosition, iTexCoord, iNormal }, uint32_t(vertices.size()));
+						if (isNewVertex)
+						{
+							vertices.push_back(vertex);
+						}
+
+						tempIndices[iFace] = it->second;
+					}
+
+					indices.push_back(tempIndices[0]);
+					if (flipAxisAndWinding) 
+					{
+						indices.push_back(tempIndices[2]);
+						indices.push_back(tempIndices[1]);
+					}
+					else
+					{
+						indices.push_back(tempIndices[1]);
+						indices.push_back(tempIndices[2]);
+					}
+				}
+				//read till end of line and ignore all remaining chars
+				file.ignore(1000, '\n');
+			}
+
+			Utils::FinalizeOBJVertices(vertices, indices, flipAxisAndWinding);
+
+			return true;
+		}
+
+		struct ParseTimings
+		{
+			double fastestMs{};
+			double averageMs{};
+		};
+
+		// parse loads the whole mesh once and returns whether that worked
+		template<typename ParseFunction>
+		static bool TimeParser(const ParseFunction& parse, int iterations, ParseTimings& timings)
+		{
+			double totalMs{};
+			timings.fastestMs = DBL_MAX;
+
+			for (int iteration{}; iteration < iterations; ++iteration)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				if (!parse())
+				{
+					return false;
+				}
+				const auto end = std::chrono::steady_clock::now();
+
+				const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+				timings.fastestMs = std::min(timings.fastestMs, ms);
+				totalMs += ms;
+			}
+
+			timings.averageMs = totalMs / iterations;
+			return true;
+		}
+
+		// 8 way set associative with LRU replacement per set, 64 sets of 64 byte lines
+		class CacheSimulator
+		{
+		public:
+			bool Access(const void* pAddress)
+			{
+				const uintptr_t line = reinterpret_cast<uintptr_t>(pAddress) / LineSize;
+				uintptr_t* pSet = m_Lines + (line % AmountOfSets) * AmountOfWays;
+
+				// Most recently used way first, a hit moves its line to the front
+				for (int way{}; way < AmountOfWays; ++way)
+				{
+					if (pSet[way] == line)
+					{
+						std::move_backward(pSet, pSet + way, pSet + way + 1);
+						pSet[0] = line;
+						return true;
+					}
+				}
+
+				std::move_backward(pSet, pSet + AmountOfWays - 1, pSet + AmountOfWays);
+				pSet[0] = line;
+				return false;
+			}
+
+		private:
+			static constexpr uintptr_t LineSize{ 64 };
+			static constexpr int AmountOfSets{ 64 };
+			static constexpr int AmountOfWays{ 8 };
+
+			uintptr_t m_Lines[AmountOfSets * AmountOfWays]{};
+		};
+
+		int CompareTextureLayouts(int iterations)
+		{
+			iterations = std::max(iterations, 1);
+
+			// 16 MB of RGBA8 texels, far more than the caches hold
+			constexpr int textureSize{ 2048 };
+			constexpr int screenSize{ 512 };
+			constexpr int screenTileSize{ 64 };
+
+			std::vector<uint32_t> rowMajor(size_t(textureSize) * textureSize);
+			std::mt19937 random{ 1234 };
+			std::generate(rowMajor.begin(), rowMajor.end(), std::ref(random));
+
+			using TextureSampling::TexelLayout;
+			const TexelLayout layouts[]{ TexelLayout::Linear, TexelLayout::Tiled };
+			const char* layoutNames[]{ "Linear", "Tiled " };
+
+			std::vector<uint32_t> levels[2]{};
+			for (int layout{}; layout < 2; ++layout)
+			{
+				levels[layout].resize(TextureSampling::GetLevelSize(textureSize, textureSize, layouts[layout]));
+				TextureSampling::StoreLevel(rowMajor.data(), textureSize, textureSize, layouts[layout], levels[layout].data());
+			}
+
+			std::cout << "Texture layouts: " << textureSize << "x" << textureSize << " RGBA8 texture, " << screenSize << "x" << screenSize
+				<< " pixels in " << screenTileSize << "x" << screenTileSize << " tiles, 1 texel per pixel, " << iterations << " iterations\n";
+
+			bool isSameResult{ true };
+
+			for (const float degrees : { 0.f, 30.f, 45.f, 90.f })
+			{
+				// Pixel to texel mapping rotated around the middle of the texture, like a triangle rotated on it
+				const float radians = degrees * 3.14159265f / 180.f;
+				const float cosine = std::cos(radians);
+				const float sine = std::sin(radians);
+
+				uint64_t sums[2]{};
+
+				for (int layout{}; layout < 2; ++layout)
+				{
+					const uint32_t* pTexels = levels[layout].data();
+					CacheSimulator cache{};
+					uint64_t hits{};
+					double fastestMs{ DBL_MAX };
+
+					for (int iteration{}; iteration < iterations; ++iteration)
+					{
+						const bool isSimulated = iteration == 0;
+						uint64_t sum{};
+
+						const auto start = std::chrono::steady_clock::now();
+						for (int tileY{}; tileY < screenSize; tileY += screenTileSize)
+						{
+							for (int tileX{}; tileX < screenSize; tileX += screenTileSize)
+							{
+								for (int py{ tileY }; py < tileY + screenTileSize; ++py)
+								{
+									for (int px{ tileX }; px < tileX + screenTileSize; ++px)
+									{
+										const float offsetX = float(px - screenSize / 2);
+										const float offsetY = float(py - screenSize / 2);
+										const int x = textureSize / 2 + int(cosine * offsetX - sine * offsetY);
+										const int y = textureSize / 2 + int(sine * offsetX + cosine * offsetY);
+
+										const uint32_t* pTexel = pTexels + TextureSampling::GetTexelIndex(x, y, textureSize, layouts[layout]);
+										sum += *pTexel;
+
+										if (isSimulated)
+										{
+											hits += cache.Access(pTexel);
+										}
+									}
+								}
+							}
+						}
+						const auto end = std::chrono::steady_clock::now();
+
+						fastestMs = std::min(fastestMs, std::chrono::duration<double, std::milli>(end - start).count());
+						sums[layout] = sum;
+					}
+
+					const double amountOfSamples = double(screenSize) * screenSize;
+					std::cout << "  " << degrees << " deg " << layoutNames[layout] << ": " << 100.0 * double(hits) / amountOfSamples << " % L1 hits, "
+						<< fastestMs * 1000000.0 / amountOfSamples << " ns per sample\n";
+				}
+
+				isSameResult = isSameResult && sums[0] == sums[1];
+			}
+
+			if (!isSameResult)
+			{
+				std::cout << "  Layouts sampled different texels!\n";
+				return 1;
+			}
+
+			return 0;
+		}
+
+		int CompareOBJParsers(const std::string& filename, int iterations)
+		{
+			iterations = std::max(iterations, 1);
+
+			std::error_code error{};
+			const uintmax_t fileSize = std::filesystem::file_size(filename, error);
+			if (error)
+			{
+				std::cout << "Can't open " << filename << "\n";
+				return 1;
+			}
+
+			std::vector<Vertex> streamVertices{};
+			std::vector<uint32_t> streamIndices{};
+			std::vector<Vertex> mappedVertices{};
+			std::vector<uint32_t> mappedIndices{};
+			BakedMesh cachedMesh{};
+			ParseTimings streamTimings{};
+			ParseTimings mappedTimings{};
+			ParseTimings cachedTimings{};
+
+			if (!TimeParser([&]() { return ParseOBJStream(filename, streamVertices, streamIndices, true); }, iterations, streamTimings)
+				|| !TimeParser([&]() { return Utils::ParseOBJ(filename, mappedVertices, mappedIndices, true); }, iterations, mappedTimings))
+			{
+				std::cout << "Failed to parse " << filename << "\n";
+				return 1;
+			}
+
+			// Time the warm cache only, the first load writes it
+			if (!MeshCache::LoadOBJ(filename, cachedMesh)
+				|| !TimeParser([&]() { return MeshCache::Read(filename, cachedMesh, true); }, iterations, cachedTimings))
+			{
+				std::cout << "Failed to use the mesh cache of " << filename << "\n";
+				return 1;
+			}
+
+			const double megabytes = double(fileSize) / (1024.0 * 1024.0);
+
+			std::cout << filename << ": " << megabytes << " MB, " << mappedVertices.size() << " vertices, " << mappedIndices.size() << " indices, "
+				<< iterations << " iterations\n";
+			std::cout << "  ParseOBJStream:  " << streamTimings.fastestMs << " ms fastest, " << streamTimings.averageMs << " ms average, "
+				<< megabytes / (streamTimings.fastestMs / 1000.0) << " MB/s\n";
+			std::cout << "  ParseOBJ:        " << mappedTimings.fastestMs << " ms fastest, " << mappedTimings.averageMs << " ms average, "
+				<< megabytes / (mappedTimings.fastestMs / 1000.0) << " MB/s\n";
+			std::cout << "  MeshCache::Read: " << cachedTimings.fastestMs << " ms fastest, " << cachedTimings.averageMs << " ms average\n";
+			std::cout << "  Speedup: " << streamTimings.fastestMs / mappedTimings.fastestMs << "x parsing, "
+				<< streamTimings.fastestMs / cachedTimings.fastestMs << "x cached\n";
+
+			// Compared bit for bit, both parsers run the same float conversions and tangent math
+			const auto isSame = [](const std::vector<Vertex>& vertices1, const std::vector<uint32_t>& indices1, const std::vector<Vertex>& vertices2, const std::vector<uint32_t>& indices2)
+			{
+				return indices1 == indices2 && vertices1.size() == vertices2.size()
+					&& std::memcmp(vertices1.data(), vertices2.data(), vertices1.size() * sizeof(Vertex)) == 0;
+			};
+
+			// The cache holds the mesh after MeshCache::Optimize
+			BakedMesh optimizedMesh{ mappedVertices, mappedIndices };
+			MeshCache::Optimize(optimizedMesh);
+
+			const bool isSameMesh = isSame(streamVertices, streamIndices, mappedVertices, mappedIndices)
+				&& isSame(optimizedMesh.vertices, optimizedMesh.indices, cachedMesh.vertices, cachedMesh.indices);
+
+			if (!isSameMesh)
+			{
+				std::cout << "  Meshes differ!\n";
+				return 1;
+			}
+
+			std::cout << "  Meshes are identical\n";
+			return 0;
+		}
+	}
+}
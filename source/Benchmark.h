@@ -0,0 +1,18 @@
+#pragma once
+
+//Standard includes
+#include <string>
+
+namespace dae
+{
+	namespace Benchmark
+	{
+		// Times Utils::ParseOBJ and a warm MeshCache::Read against the original iostream parser on the same file and checks that all give the same mesh.
+		// Returns the exit code for main
+		int CompareOBJParsers(const std::string& filename, int iterations);
+
+		// Samples a synthetic texture stored linear and tiled along screen tiles at several rotations of the uv mapping,
+		// prints the hit rate of a simulated 32 KB L1 cache and the time per sample of every combination. Returns the exit code for main
+		int CompareTextureLayouts(int iterations);
+	}
+}
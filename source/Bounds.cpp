@@ -0,0 +1,294 @@
+#include "Bounds.h"
+
+//Standard includes
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+//Project includes
+#include "DataTypes.h"
+
+namespace dae
+{
+	static float PlaneDistance(const Vector4& plane, const Vector3& point)
+	{
+		return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+	}
+
+	Frustum Frustum::FromMatrix(const Matrix& matrix)
+	{
+		// Points are row vectors, so clip.x is the dot product of the point with the first column and so on
+		Vector4 columns[4]{};
+		for (int column{}; column < 4; ++column)
+		{
+			columns[column] = Vector4{ matrix[0][column], matrix[1][column], matrix[2][column], matrix[3][column] };
+		}
+
+		// Same planes as the clipper: near, far, left, right, bottom, top
+		Frustum frustum{};
+		frustum.planes[0] = columns[2];
+		frustum.planes[1] = columns[3] - columns[2];
+		frustum.planes[2] = columns[3] + columns[0];
+		frustum.planes[3] = columns[3] - columns[0];
+		frustum.planes[4] = columns[3] + columns[1];
+		frustum.planes[5] = columns[3] - columns[1];
+
+		for (Vector4& plane : frustum.planes)
+		{
+			const float length = plane.GetXYZ().Magnitude();
+			if (length > 0.f)
+			{
+				plane = plane * (1.f / length);
+			}
+		}
+
+		return frustum;
+	}
+
+	bool Frustum::IsOutside(const BoundingBox& box) const
+	{
+		for (const Vector4& plane : planes)
+		{
+			// The corner furthest along the plane normal, when even that one is outside the whole box is
+			const Vector3 corner{ plane.x >= 0.f ? box.max.x : box.min.x, plane.y >= 0.f ? box.max.y : box.min.y, plane.z >= 0.f ? box.max.z : box.min.z };
+			if (PlaneDistance(plane, corner) < 0.f)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool Frustum::IsOutside(const BoundingSphere& sphere) const
+	{
+		for (const Vector4& plane : planes)
+		{
+			if (PlaneDistance(plane, sphere.center) < -sphere.radius)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	namespace Bounds
+	{
+		// Normals of a cluster spread over more than this (the dot product with the average normal) can't be rejected in practice
+		constexpr float MinConeSpread{ .1f };
+
+		static BoundingBox ComputeBoundingBox(const Vector3* pPositions, size_t amountOfPositions)
+		{
+			BoundingBox box{ Vector3{ FLT_MAX, FLT_MAX, FLT_MAX }, Vector3{ -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+			for (size_t index{}; index < amountOfPositions; ++index)
+			{
+				const Vector3& position = pPositions[index];
+				box.min = Vector3{ std::min(box.min.x, position.x), std::min(box.min.y, position.y), std::min(box.min.z, position.z) };
+				box.max = Vector3{ std::max(box.max.x, position.x), std::max(box.max.y, position.y), std::max(box.max.z, position.z) };
+			}
+
+			return box;
+		}
+
+		static BoundingSphere ComputeBoundingSphere(const Vector3* pPositions, size_t amountOfPositions)
+		{
+			if (amountOfPositions == 0)
+				return {};
+
+			const BoundingBox box = ComputeBoundingBox(pPositions, amountOfPositions);
+
+			BoundingSphere sphere{};
+			sphere.center = (box.min + box.max) * .5f;
+
+			float squaredRadius{};
+			for (size_t index{}; index < amountOfPositions; ++index)
+			{
+				squaredRadius = std::max(squaredRadius, (pPositions[index] - sphere.center).SqrMagnitude());
+			}
+
+			sphere.radius = std::sqrt(squaredRadius);
+			return sphere;
+		}
+
+		BoundingBox ComputeBoundingBox(const std::vector<Vertex>& vertices)
+		{
+			if (vertices.empty())
+				return {};
+
+			std::vector<Vector3> positions(vertices.size());
+			std::transform(vertices.begin(), vertices.end(), positions.begin(), [](const Vertex& vertex) { return vertex.position; });
+
+			return ComputeBoundingBox(positions.data(), positions.size());
+		}
+
+		BoundingSphere ComputeBoundingSphere(const std::vector<Vertex>& vertices)
+		{
+			std::vector<Vector3> positions(vertices.size());
+			std::transform(vertices.begin(), vertices.end(), positions.begin(), [](const Vertex& vertex) { return vertex.position; });
+
+			return ComputeBoundingSphere(positions.data(), positions.size());
+		}
+
+		std::vector<Cluster> BuildClusters(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+		{
+			const uint32_t amountOfTriangles = uint32_t(indices.size() / 3);
+
+			// The cluster that last used a vertex, to count the vertices of the cluster being built
+			std::vector<uint32_t> vertexCluster(vertices.size(), UINT32_MAX);
+
+			std::vector<Cluster> clusters{};
+			Cluster cluster{};
+			uint32_t amountOfClusterVertices{};
+
+			// Every cluster takes the next triangles in the order they come in, the vertex cache order MeshOptimizer left behind
+			// is kept that way. It only ends at the first triangle that doesn't fit in it anymore, clusters whose normals
+			// spread too far simply don't get a cone to be rejected on below
+			for (uint32_t triangle{}; triangle < amountOfTriangles; ++triangle)
+			{
+				const uint32_t clusterIndex = uint32_t(clusters.size());
+
+				uint32_t amountOfNewVertices{};
+				for (int corner{}; corner < 3; ++corner)
+				{
+					amountOfNewVertices += vertexCluster[indices[3 * size_t(triangle) + corner]] != clusterIndex;
+				}
+
+				const bool isFitting = amountOfClusterVertices + amountOfNewVertices <= MaxClusterVertices
+					&& cluster.amountOfIndices / 3 < MaxClusterTriangles;
+
+				if (!isFitting)
+				{
+					clusters.push_back(cluster);
+
+					cluster = Cluster{};
+					cluster.firstIndex = 3 * triangle;
+					amountOfClusterVertices = 0;
+				}
+
+				for (int corner{}; corner < 3; ++corner)
+				{
+					const uint32_t vertex = indices[3 * size_t(triangle) + corner];
+					if (vertexCluster[vertex] != uint32_t(clusters.size()))
+					{
+						vertexCluster[vertex] = uint32_t(clusters.size());
+						++amountOfClusterVertices;
+					}
+				}
+
+				cluster.amountOfIndices += 3;
+			}
+
+			if (cluster.amountOfIndices > 0)
+			{
+				clusters.push_back(cluster);
+			}
+
+			// Bounds and normal cone of every cluster over its own corners and faces
+			std::vector<Vector3> corners{};
+			for (Cluster& cluster : clusters)
+			{
+				corners.clear();
+
+				Vector3 normalSum{};
+				for (uint32_t index{ cluster.firstIndex }; index < cluster.firstIndex + cluster.amountOfIndices; index += 3)
+				{
+					const Vector3& p0 = vertices[indices[index]].position;
+					const Vector3& p1 = vertices[indices[index + 1]].position;
+					const Vector3& p2 = vertices[indices[index + 2]].position;
+					corners.insert(corners.end(), { p0, p1, p2 });
+
+					const Vector3 normal = Vector3::Cross(p1 - p0, p2 - p0);
+					if (normal.Magnitude() > 0.f)
+					{
+						normalSum += normal.Normalized();
+					}
+				}
+
+				cluster.sphere = ComputeBoundingSphere(corners.data(), corners.size());
+
+				if (normalSum.Magnitude() == 0.f)
+					continue;
+
+				cluster.coneAxis = normalSum.Normalized();
+
+				float minDot{ 1.f };
+				for (uint32_t index{ cluster.firstIndex }; index < cluster.firstIndex + cluster.amountOfIndices; index += 3)
+				{
+					const Vector3& p0 = vertices[indices[index]].position;
+					const Vector3 normal = Vector3::Cross(vertices[indices[index + 1]].position - p0, vertices[indices[index + 2]].position - p0);
+					if (normal.Magnitude() > 0.f)
+					{
+						minDot = std::min(minDot, Vector3::Dot(cluster.coneAxis, normal.Normalized()));
+					}
+				}
+
+				// A cone of normals with half angle a only faces away from every direction within 90 - a degrees
+				// of its axis, sin(a) is the cosine of that angle. Wider cones keep coneCutoff at 1 and are never rejected
+				if (minDot > MinConeSpread)
+				{
+					cluster.coneCutoff = std::sqrt(1.f - minDot * minDot);
+				}
+			}
+
+			return clusters;
+		}
+
+		void BuildClusterVertices(std::vector<Cluster>& clusters, const std::vector<uint32_t>& indices, std::vector<uint32_t>& clusterVertices, std::vector<uint8_t>& clusterIndices)
+		{
+			clusterVertices.clear();
+			clusterIndices.resize(indices.size());
+
+			// Local index of every vertex in the cluster that last used it
+			std::vector<uint8_t> localIndices{};
+			std::vector<uint32_t> vertexCluster{};
+
+			for (uint32_t clusterIndex{}; clusterIndex < uint32_t(clusters.size()); ++clusterIndex)
+			{
+				Cluster& cluster = clusters[clusterIndex];
+				cluster.firstVertex = uint32_t(clusterVertices.size());
+
+				for (uint32_t index{ cluster.firstIndex }; index < cluster.firstIndex + cluster.amountOfIndices; ++index)
+				{
+					const uint32_t vertex = indices[index];
+					if (vertex >= vertexCluster.size())
+					{
+						vertexCluster.resize(size_t(vertex) + 1, UINT32_MAX);
+						localIndices.resize(size_t(vertex) + 1);
+					}
+
+					if (vertexCluster[vertex] != clusterIndex)
+					{
+						vertexCluster[vertex] = clusterIndex;
+						localIndices[vertex] = uint8_t(clusterVertices.size() - cluster.firstVertex);
+						clusterVertices.push_back(vertex);
+					}
+
+					clusterIndices[index] = localIndices[vertex];
+				}
+
+				cluster.amountOfVertices = uint32_t(clusterVertices.size()) - cluster.firstVertex;
+			}
+		}
+
+		// Every direction from a point in the sphere to the eye lies within the cone around axis
+		static bool IsFacingAway(const Cluster& cluster, const Vector3& eye, const Vector3& axis)
+		{
+			if (cluster.coneCutoff >= 1.f)
+				return false;
+
+			const Vector3 toCenter = cluster.sphere.center - eye;
+			return Vector3::Dot(toCenter, axis) >= cluster.coneCutoff * toCenter.Magnitude() + cluster.sphere.radius;
+		}
+
+		bool IsBackFacing(const Cluster& cluster, const Vector3& eye)
+		{
+			return IsFacingAway(cluster, eye, cluster.coneAxis);
+		}
+
+		bool IsFrontFacing(const Cluster& cluster, const Vector3& eye)
+		{
+			return IsFacingAway(cluster, eye, -cluster.coneAxis);
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <vector>
+
+//Project includes
+#include "Math.h"
+
+namespace dae
+{
+	struct Vertex;
+
+	struct BoundingBox
+	{
+		Vector3 min{};
+		Vector3 max{};
+	};
+
+	struct BoundingSphere
+	{
+		Vector3 center{};
+		float radius{};
+	};
+
+	// A meshlet: a run of consecutive triangles in the index buffer over a handful of vertices,
+	// with the sphere around its corners and the cone its face normals lie in
+	struct Cluster
+	{
+		uint32_t firstIndex{};
+		uint32_t amountOfIndices{};
+
+		// Range of its vertices in the cluster vertex list, the local index of every corner sits at the same position as in the index buffer
+		uint32_t firstVertex{};
+		uint32_t amountOfVertices{};
+
+		BoundingSphere sphere{};
+
+		// Sine of the half angle of the normal cone, 1 when the normals spread too far to ever reject the cluster
+		Vector3 coneAxis{};
+		float coneCutoff{ 1.f };
+	};
+
+	// The 6 planes of a view frustum, in the space the points start in before the matrix it was built from
+	struct Frustum
+	{
+		// (a, b, c, d) with a unit normal pointing inwards, a point is inside a plane when a*x + b*y + c*z + d >= 0
+		Vector4 planes[6]{};
+
+		// Planes of the clip volume (0 <= z <= w, -w <= x, y <= w) of a matrix that ends in clip space
+		static Frustum FromMatrix(const Matrix& matrix);
+
+		// Conservative, a box or sphere near a corner of the frustum can be reported as inside while it isn't
+		bool IsOutside(const BoundingBox& box) const;
+		bool IsOutside(const BoundingSphere& sphere) const;
+	};
+
+	namespace Bounds
+	{
+		// Local indices are 8 bit, 64 vertices and 124 triangles keep a cluster within a few cache lines
+		constexpr uint32_t MaxClusterVertices{ 64 };
+		constexpr uint32_t MaxClusterTriangles{ 124 };
+
+		BoundingBox ComputeBoundingBox(const std::vector<Vertex>& vertices);
+
+		// Centered on the bounding box, not the smallest sphere but cheap and tight enough for culling
+		BoundingSphere ComputeBoundingSphere(const std::vector<Vertex>& vertices);
+
+		// Cuts the triangle list in runs of consecutive triangles that each fill up to MaxClusterVertices or MaxClusterTriangles.
+		// The triangles keep their order, run MeshOptimizer::OptimizeMesh before so the runs are compact and cache friendly
+		std::vector<Cluster> BuildClusters(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+		// Fills the vertex range of every cluster, once the vertices won't be renumbered anymore
+		void BuildClusterVertices(std::vector<Cluster>& clusters, const std::vector<uint32_t>& indices, std::vector<uint32_t>& clusterVertices, std::vector<uint8_t>& clusterIndices);
+
+		// True when every triangle of the cluster is seen from behind, respectively from the front, from eye.
+		// Everything in mesh space, exact for rotations, translations and uniform scales
+		bool IsBackFacing(const Cluster& cluster, const Vector3& eye);
+		bool IsFrontFacing(const Cluster& cluster, const Vector3& eye);
+	}
+}
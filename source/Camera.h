@@ -36,13 +36,22 @@ namespace dae
 		Matrix viewMatrix{};
 		Matrix projectionMatrix{};
 
+		// Bumped every time viewMatrix or projectionMatrix change, so results that depend on them can tell when to refresh
+		uint64_t version{};
+
+		// Set these when changing origin, rotation, fov or aspect ratio outside of Initialize and Update
+		bool isViewDirty{ true };
+		bool isProjectionDirty{ true };
+
 		void Initialize(float ar, float _fovAngle = 90.f, Vector3 _origin = {0.f,0.f,0.f})
 		{
 			fovAngle = _fovAngle;
 			fov = tanf((fovAngle * TO_RADIANS) / 2.f);
 			aspectRatio = ar;
+			isProjectionDirty = true;
 
 			origin = _origin;
+			isViewDirty = true;
 		}
 
 		void CalculateViewMatrix()
@@ -85,6 +94,9 @@ namespace dae
 		void Update(Timer* pTimer)
 		{
 			const float deltaTime = pTimer->GetElapsed();
+			const Vector3 previousOrigin = origin;
+			const float previousTotalPitch = totalPitch;
+			const float previousTotalYaw = totalYaw;
 
 			//Camera Update Logic
 
@@ -147,9 +159,23 @@ namespace dae
 				totalYaw += mouseX;
 			}
 
-			//Update Matrices
-			CalculateViewMatrix();
-			CalculateProjectionMatrix(); //Try to optimize this - should only be called once or when fov/aspectRatio changes
+			//Update Matrices, only when something moved or the lens changed
+			const bool hasMoved = origin.x != previousOrigin.x || origin.y != previousOrigin.y || origin.z != previousOrigin.z
+				|| totalPitch != previousTotalPitch || totalYaw != previousTotalYaw;
+
+			if (hasMoved || isViewDirty)
+			{
+				CalculateViewMatrix();
+				isViewDirty = false;
+				++version;
+			}
+
+			if (isProjectionDirty)
+			{
+				CalculateProjectionMatrix();
+				isProjectionDirty = false;
+				++version;
+			}
 		}
 	};
 }
@@ -1,6 +1,9 @@
 #pragma once
 #include "Math.h"
 #include "vector"
+#include <cstdint>
+#include "Bounds.h"
+#include "VertexStream.h"
 
 namespace dae
 {
@@ -16,6 +19,7 @@ namespace dae
 
 	struct Vertex_Out
 	{
+		// Clip space out of the vertex stage, raster space (x, y, z / w, w) once binned
 		Vector4 position{};
 		ColorRGB color{ colors::White };
 		Vector2 uv{};
@@ -24,6 +28,11 @@ namespace dae
 		Vector3 viewDirection{};
 	};
 
+	struct Triangle_Out
+	{
+		Vertex_Out vertices[3]{};
+	};
+
 	enum class PrimitiveTopology
 	{
 		TriangleList,
@@ -36,17 +45,41 @@ namespace dae
 		std::vector<uint32_t> indices{};
 		PrimitiveTopology primitiveTopology{ PrimitiveTopology::TriangleList };
 
+		// Same vertices as above split per component for the SIMD vertex stage, refill it with Assign when vertices change
+		VertexStream vertexStream{};
+
+		// Mesh space bounds, filled at load time. Triangle lists are drawn cluster by cluster, see Bounds::BuildClusters
+		BoundingBox boundingBox{};
+		BoundingSphere boundingSphere{};
+		std::vector<Cluster> clusters{};
+		// The vertices of every cluster and the cluster local index of every entry in indices, see Bounds::BuildClusterVertices
+		std::vector<uint32_t> clusterVertices{};
+		std::vector<uint8_t> clusterIndices{};
+
 		std::vector<Vertex_Out> vertices_out{};
+		// Raster space (x, y, z / w, w) of every vertex in vertices_out, only valid for vertices in front of the near plane
+		std::vector<Vector4> positions_raster{};
+		// Culling state of the last vertex stage: whether the mesh is in the view frustum at all, and the frustum and camera in mesh space
+		bool isVisible{ true };
+		Frustum localFrustum{};
+		Vector3 localCameraOrigin{};
 		Matrix worldMatrix{};
 		Matrix transformMatrix{};
 		Matrix scaleMatrix{};
 		Matrix rotationMatrix{};
 
+		// Bump after changing the vertices or matrices directly, the renderer only transforms meshes again when this
+		// or the camera version differs from the versions vertices_out was transformed with
+		uint64_t version{ 1 };
+		uint64_t transformedVersion{};
+		uint64_t transformedCameraVersion{};
+
 		float yawRotation{};
 		void AddRotationY(float yaw)
 		{
 			yawRotation += yaw;
 			rotationMatrix = Matrix::CreateRotationY(yawRotation);
+			++version;
 		};
 	};
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+#if defined(_WIN32)
+	MappedFile::MappedFile(const std::string& filename)
+	{
+		m_FileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_FileHandle == INVALID_HANDLE_VALUE)
+		{
+			m_FileHandle = nullptr;
+			return;
+		}
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(m_FileHandle, &fileSize))
+		{
+			return;
+		}
+
+		m_Size = static_cast<size_t>(fileSize.QuadPart);
+		m_IsOpen = true;
+
+		// An empty file can't be mapped, but it is still a valid file
+		if (m_Size == 0)
+		{
+			return;
+		}
+
+		m_MappingHandle = CreateFileMappingA(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_MappingHandle)
+		{
+			m_pData = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+		}
+
+		m_IsOpen = m_pData != nullptr;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_pData)
+		{
+			UnmapViewOfFile(m_pData);
+		}
+
+		if (m_MappingHandle)
+		{
+			CloseHandle(m_MappingHandle);
+		}
+
+		if (m_FileHandle)
+		{
+			CloseHandle(m_FileHandle);
+		}
+	}
+#else
+	MappedFile::MappedFile(const std::string& filename)
+	{
+		const int fileDescriptor = open(filename.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+		{
+			return;
+		}
+
+		struct stat fileStatus {};
+		if (fstat(fileDescriptor, &fileStatus) == 0)
+		{
+			m_Size = static_cast<size_t>(fileStatus.st_size);
+			m_IsOpen = true;
+
+			// An empty file can't be mapped, but it is still a valid file
+			if (m_Size != 0)
+			{
+				void* pMapping = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+				if (pMapping != MAP_FAILED)
+				{
+					madvise(pMapping, m_Size, MADV_SEQUENTIAL);
+					m_pData = static_cast<const char*>(pMapping);
+				}
+
+				m_IsOpen = m_pData != nullptr;
+			}
+		}
+
+		// The mapping stays valid after the descriptor is closed
+		close(fileDescriptor);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_pData)
+		{
+			munmap(const_cast<char*>(m_pData), m_Size);
+		}
+	}
+#endif
+}
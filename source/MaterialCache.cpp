@@ -0,0 +1,305 @@
+#include "MaterialCache.h"
+
+//Standard includes
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+//Project includes
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "SourceStamp.h"
+
+namespace dae
+{
+	namespace MaterialCache
+	{
+		// Bump when the layout of the file changes or when the texels change meaning
+		constexpr uint32_t FormatVersion{ 1 };
+		constexpr char Magic[4]{ 'D', 'A', 'E', 'X' };
+
+		// Enough for a 65536 x 65536 material
+		constexpr uint32_t MaxSize{ 65536 };
+
+		// The texels start on a cache line
+		constexpr uint64_t BlobAlignment{ 64 };
+
+		// Everything is stored in the native layout of the machine that wrote the file, the texels of every level follow the header
+		struct Header
+		{
+			char magic[4]{};
+			uint32_t version{};
+			uint32_t texelSize{};
+			uint32_t layout{};
+			uint32_t width{};
+			uint32_t height{};
+
+			// Maps at the time the cache was written
+			SourceStamp sources[AmountOfMaps]{};
+
+			uint64_t amountOfTexels{};
+			uint64_t texelsOffset{};
+		};
+
+		std::string GetCachePath(const std::string& diffusePath)
+		{
+			return diffusePath + ".matbin";
+		}
+
+		void BuildMipChain(BakedTexture& texture)
+		{
+			if (texture.mipLevels.empty())
+				return;
+
+			texture.mipLevels.resize(1);
+
+			while (texture.mipLevels.back().width > 1 || texture.mipLevels.back().height > 1)
+			{
+				const BakedTexture::MipLevel& source = texture.mipLevels.back();
+
+				BakedTexture::MipLevel level{};
+				level.width = std::max(source.width / 2, 1);
+				level.height = std::max(source.height / 2, 1);
+				level.texels.resize(size_t(level.width) * level.height);
+
+				// Average of the 2x2 source texels under every texel, a side of 1 repeats its single row or column
+				ParallelFor(0, level.height, [&](int y)
+				{
+					const int sourceY0 = std::min(2 * y, source.height - 1);
+					const int sourceY1 = std::min(2 * y + 1, source.height - 1);
+
+					for (int x{}; x < level.width; ++x)
+					{
+						const int sourceX0 = std::min(2 * x, source.width - 1);
+						const int sourceX1 = std::min(2 * x + 1, source.width - 1);
+
+						const uint32_t texels[4]{
+							source.texels[size_t(sourceY0) * source.width + sourceX0],
+							source.texels[size_t(sourceY0) * source.width + sourceX1],
+							source.texels[size_t(sourceY1) * source.width + sourceX0],
+							source.texels[size_t(sourceY1) * source.width + sourceX1],
+						};
+
+						uint32_t result{};
+						for (int channel{}; channel < 4; ++channel)
+						{
+							const int shift = 8 * channel;
+							uint32_t sum{ 2 };
+							for (const uint32_t texel : texels)
+							{
+								sum += (texel >> shift) & 0xFF;
+							}
+
+							result |= (sum / 4) << shift;
+						}
+
+						level.texels[size_t(y) * level.width + x] = result;
+					}
+				});
+
+				texture.mipLevels.push_back(std::move(level));
+			}
+		}
+
+		// Lays out the levels of a full mip chain under a level 0 of width x height, with room for all their texels
+		static void AllocateLevels(BakedMaterial& material, int width, int height)
+		{
+			material.mipLevels.clear();
+			material.mipLevels.push_back({ width, height, 0 });
+
+			size_t amountOfTexels = TextureSampling::GetLevelSize(width, height, material.layout);
+			while (material.mipLevels.back().width > 1 || material.mipLevels.back().height > 1)
+			{
+				BakedMaterial::MipLevel level{};
+				level.width = std::max(material.mipLevels.back().width / 2, 1);
+				level.height = std::max(material.mipLevels.back().height / 2, 1);
+				level.firstTexel = amountOfTexels;
+
+				amountOfTexels += TextureSampling::GetLevelSize(level.width, level.height, material.layout);
+				material.mipLevels.push_back(level);
+			}
+
+			material.texels.resize(amountOfTexels);
+		}
+
+		// Level 0 of a map at the size of the material, nearest texel when the sizes differ
+		static BakedTexture::MipLevel ResampleLevel(const BakedTexture::MipLevel& source, int width, int height)
+		{
+			BakedTexture::MipLevel level{};
+			level.width = width;
+			level.height = height;
+			level.texels.resize(size_t(width) * height);
+
+			for (int y{}; y < height; ++y)
+			{
+				const int sourceY = int((int64_t(y) * source.height) / height);
+				for (int x{}; x < width; ++x)
+				{
+					const int sourceX = int((int64_t(x) * source.width) / width);
+					level.texels[size_t(y) * width + x] = source.texels[size_t(sourceY) * source.width + sourceX];
+				}
+			}
+
+			return level;
+		}
+
+		bool Bake(const BakedTexture (&maps)[AmountOfMaps], TextureSampling::TexelLayout layout, BakedMaterial& material)
+		{
+			for (const BakedTexture& map : maps)
+			{
+				if (map.mipLevels.empty() || map.mipLevels[0].texels.empty())
+					return false;
+			}
+
+			const int width = maps[0].mipLevels[0].width;
+			const int height = maps[0].mipLevels[0].height;
+
+			// Every map gets its own chain, a box filter averages every channel on its own so that is the chain of the interleaved texels too
+			BakedTexture chains[AmountOfMaps]{};
+			for (int map{}; map < AmountOfMaps; ++map)
+			{
+				const BakedTexture::MipLevel& level = maps[map].mipLevels[0];
+				chains[map].mipLevels.push_back(level.width == width && level.height == height ? level : ResampleLevel(level, width, height));
+				BuildMipChain(chains[map]);
+			}
+
+			material.layout = layout;
+			AllocateLevels(material, width, height);
+
+			// Decoded texels are RGBA8 with red in the lowest byte
+			std::vector<MaterialTexel> rowMajor{};
+			for (size_t levelIndex{}; levelIndex < material.mipLevels.size(); ++levelIndex)
+			{
+				const BakedMaterial::MipLevel& level = material.mipLevels[levelIndex];
+				const std::vector<uint32_t>& diffuses = chains[0].mipLevels[levelIndex].texels;
+				const std::vector<uint32_t>& normals = chains[1].mipLevels[levelIndex].texels;
+				const std::vector<uint32_t>& speculars = chains[2].mipLevels[levelIndex].texels;
+				const std::vector<uint32_t>& glossinesses = chains[3].mipLevels[levelIndex].texels;
+
+				rowMajor.resize(diffuses.size());
+				for (size_t index{}; index < diffuses.size(); ++index)
+				{
+					MaterialTexel& texel = rowMajor[index];
+					for (int channel{}; channel < 3; ++channel)
+					{
+						texel.diffuse[channel] = uint8_t(diffuses[index] >> (8 * channel));
+						texel.normal[channel] = uint8_t(normals[index] >> (8 * channel));
+					}
+
+					texel.specular = uint8_t(speculars[index]);
+					texel.glossiness = uint8_t(glossinesses[index]);
+				}
+
+				TextureSampling::StoreLevel(rowMajor.data(), level.width, level.height, layout, material.texels.data() + level.firstTexel);
+			}
+
+			return true;
+		}
+
+		bool Read(const std::string (&paths)[AmountOfMaps], TextureSampling::TexelLayout layout, BakedMaterial& material)
+		{
+			SourceStamp sources[AmountOfMaps]{};
+			bool isWriteTimeStale{};
+
+			{
+				const MappedFile file{ GetCachePath(paths[0]) };
+				if (!file.IsOpen() || file.GetSize() < sizeof(Header))
+					return false;
+
+				Header header{};
+				std::memcpy(&header, file.GetData(), sizeof(Header));
+
+				if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != FormatVersion
+					|| header.texelSize != sizeof(MaterialTexel) || header.layout != uint32_t(layout)
+					|| header.width == 0 || header.width > MaxSize || header.height == 0 || header.height > MaxSize)
+					return false;
+
+				for (int map{}; map < AmountOfMaps; ++map)
+				{
+					if (!header.sources[map].Matches(paths[map], sources[map]))
+						return false;
+
+					isWriteTimeStale = isWriteTimeStale || sources[map].writeTime != header.sources[map].writeTime;
+				}
+
+				if (header.texelsOffset > file.GetSize() || header.amountOfTexels > (file.GetSize() - header.texelsOffset) / sizeof(MaterialTexel))
+					return false;
+
+				// The levels follow from the size, the file has to hold exactly their texels
+				material.layout = layout;
+				AllocateLevels(material, int(header.width), int(header.height));
+
+				if (header.amountOfTexels != material.texels.size())
+					return false;
+
+				std::memcpy(material.texels.data(), file.GetData() + header.texelsOffset, material.texels.size() * sizeof(MaterialTexel));
+			}
+
+			// Same contents, so only store the new write times and skip hashing on the next load
+			if (isWriteTimeStale)
+			{
+				std::fstream file(GetCachePath(paths[0]), std::ios::binary | std::ios::in | std::ios::out);
+				for (int map{}; map < AmountOfMaps; ++map)
+				{
+					file.seekp(offsetof(Header, sources) + map * sizeof(SourceStamp) + offsetof(SourceStamp, writeTime));
+					file.write(reinterpret_cast<const char*>(&sources[map].writeTime), sizeof(sources[map].writeTime));
+				}
+			}
+
+			return true;
+		}
+
+		bool Write(const std::string (&paths)[AmountOfMaps], const BakedMaterial& material)
+		{
+			if (material.mipLevels.empty())
+				return false;
+
+			Header header{};
+			std::memcpy(header.magic, Magic, sizeof(Magic));
+			header.version = FormatVersion;
+			header.texelSize = sizeof(MaterialTexel);
+			header.layout = uint32_t(material.layout);
+			header.width = uint32_t(material.mipLevels[0].width);
+			header.height = uint32_t(material.mipLevels[0].height);
+			header.amountOfTexels = material.texels.size();
+			header.texelsOffset = (sizeof(Header) + BlobAlignment - 1) & ~(BlobAlignment - 1);
+
+			for (int map{}; map < AmountOfMaps; ++map)
+			{
+				if (!SourceStamp::FromFile(paths[map], header.sources[map], true))
+					return false;
+			}
+
+			// Written next to the final file and renamed, so a crash never leaves a half written cache behind
+			const std::string cachePath = GetCachePath(paths[0]);
+			const std::string temporaryPath = cachePath + ".tmp";
+
+			{
+				std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+				if (!file)
+					return false;
+
+				const char padding[BlobAlignment]{};
+
+				file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+				file.write(padding, header.texelsOffset - sizeof(Header));
+				file.write(reinterpret_cast<const char*>(material.texels.data()), material.texels.size() * sizeof(MaterialTexel));
+
+				if (!file)
+					return false;
+			}
+
+			std::error_code error{};
+			std::filesystem::rename(temporaryPath, cachePath, error);
+			if (error)
+			{
+				std::filesystem::remove(temporaryPath, error);
+				return false;
+			}
+
+			return true;
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+//Project includes
+#include "TextureSampling.h"
+
+namespace dae
+{
+	// An image decoded to RGBA8 texels (red in the lowest byte) with its mip chain, level 0 first
+	struct BakedTexture
+	{
+		struct MipLevel
+		{
+			int width{};
+			int height{};
+			std::vector<uint32_t> texels{};
+		};
+
+		std::vector<MipLevel> mipLevels{};
+	};
+
+	// The diffuse, normal, specular and glossiness maps of a material interleaved into one 8 byte texel,
+	// so shading a pixel touches one cache line instead of one in each of four images.
+	// Specular and glossiness maps are grey, only their red channel is kept.
+	// No default member initializers, the texel has to stay trivial to be stored as raw bytes
+	struct MaterialTexel
+	{
+		uint8_t diffuse[3];
+		uint8_t normal[3];
+		uint8_t specular;
+		uint8_t glossiness;
+	};
+
+	static_assert(sizeof(MaterialTexel) == 8 && std::is_trivial_v<MaterialTexel>);
+
+	// A material the way MaterialTexture samples it: the interleaved texels of every mip level after each other in one layout
+	struct BakedMaterial
+	{
+		struct MipLevel
+		{
+			int width{};
+			int height{};
+			size_t firstTexel{};
+		};
+
+		TextureSampling::TexelLayout layout{};
+
+		// Level 0 first, down to 1x1
+		std::vector<MipLevel> mipLevels{};
+		std::vector<MaterialTexel> texels{};
+	};
+
+	// Baked materials stored next to their diffuse map as <diffuse>.matbin and memory mapped when they are read back,
+	// so loading skips the image decoder, the interleaving and the mip generation. AssetBaker writes them ahead of time
+	namespace MaterialCache
+	{
+		// Diffuse, normal, specular and glossiness, the order every function here takes the maps in
+		constexpr int AmountOfMaps{ 4 };
+
+		// Box filters level 0 down to 1x1, replacing any levels after it
+		void BuildMipChain(BakedTexture& texture);
+
+		// Interleaves level 0 of the decoded maps into layout and box filters it down to 1x1.
+		// Maps that differ in size from the diffuse map are resampled to it. Returns false when a map is empty
+		bool Bake(const BakedTexture (&maps)[AmountOfMaps], TextureSampling::TexelLayout layout, BakedMaterial& material);
+
+		// Returns false when the cache doesn't exist or doesn't belong to the current maps or layout
+		bool Read(const std::string (&paths)[AmountOfMaps], TextureSampling::TexelLayout layout, BakedMaterial& material);
+		bool Write(const std::string (&paths)[AmountOfMaps], const BakedMaterial& material);
+
+		std::string GetCachePath(const std::string& diffusePath);
+	}
+}
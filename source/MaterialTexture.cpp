@@ -0,0 +1,109 @@
+#include "MaterialTexture.h"
+#include "Texture.h"
+#include "Vector2.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace dae
+{
+	MaterialTexture* MaterialTexture::LoadFromFiles(const std::string& diffusePath, const std::string& normalPath, const std::string& specularPath, const std::string& glossinessPath,
+		TextureSampling::TexelLayout layout)
+	{
+		const std::string paths[MaterialCache::AmountOfMaps]{ diffusePath, normalPath, specularPath, glossinessPath };
+
+		BakedMaterial material{};
+		if (MaterialCache::Read(paths, layout, material))
+		{
+			return new MaterialTexture(std::move(material));
+		}
+
+		BakedTexture maps[MaterialCache::AmountOfMaps]{};
+		for (int map{}; map < MaterialCache::AmountOfMaps; ++map)
+		{
+			if (!Texture::DecodeFile(paths[map], maps[map]))
+			{
+				throw std::runtime_error("Error, texture file not found");
+			}
+		}
+
+		if (!MaterialCache::Bake(maps, layout, material))
+		{
+			throw std::runtime_error("Error, texture file is empty");
+		}
+
+		// A cache that can't be written (read only folder) only costs the next start the decode again
+		MaterialCache::Write(paths, material);
+		return new MaterialTexture(std::move(material));
+	}
+
+	MaterialSample MaterialTexture::Sample(const Vector2& uv) const
+	{
+		return Unpack(FetchTexel(uv, 0));
+	}
+
+	MaterialSample MaterialTexture::Sample(const Vector2& uv, const Vector2& ddx, const Vector2& ddy) const
+	{
+		const float levelOfDetail = TextureSampling::ComputeLevelOfDetail(ddx, ddy, GetWidth(), GetHeight(), GetAmountOfLevels());
+
+		if (m_SamplerState.filter == TextureSampling::Filter::Point)
+		{
+			return Unpack(FetchTexel(uv, int(levelOfDetail + .5f)));
+		}
+
+		const int level = int(levelOfDetail);
+		const uint16_t coarserWeight = TextureSampling::GetLevelWeight(levelOfDetail);
+
+		const uint64_t finerTexel = FetchTexel(uv, level);
+		if (coarserWeight == 0)
+		{
+			return Unpack(finerTexel);
+		}
+
+		// Both levels through the same byte blend as the bilinear footprint, with the other two weights left at 0
+		const uint64_t texels[4]{ finerTexel, FetchTexel(uv, level + 1), 0, 0 };
+		const uint16_t weights[4]{ uint16_t(256 - coarserWeight), coarserWeight, 0, 0 };
+		return Unpack(TextureSampling::BlendTexels(texels, weights));
+	}
+
+	uint64_t MaterialTexture::FetchTexel(const Vector2& uv, int levelIndex) const
+	{
+		const BakedMaterial::MipLevel& level = m_Material.mipLevels[levelIndex];
+
+		uint64_t texel{};
+		if (m_SamplerState.filter == TextureSampling::Filter::Point)
+		{
+			int x{}, y{};
+			TextureSampling::GetPointTexel(uv, level.width, level.height, m_SamplerState.addressMode, x, y);
+			std::memcpy(&texel, &TexelAt(level, x, y), sizeof(MaterialTexel));
+			return texel;
+		}
+
+		const TextureSampling::BilinearFootprint footprint = TextureSampling::GetBilinearFootprint(uv, level.width, level.height, m_SamplerState.addressMode);
+
+		uint64_t texels[4]{};
+		std::memcpy(&texels[0], &TexelAt(level, footprint.x[0], footprint.y[0]), sizeof(MaterialTexel));
+		std::memcpy(&texels[1], &TexelAt(level, footprint.x[1], footprint.y[0]), sizeof(MaterialTexel));
+		std::memcpy(&texels[2], &TexelAt(level, footprint.x[0], footprint.y[1]), sizeof(MaterialTexel));
+		std::memcpy(&texels[3], &TexelAt(level, footprint.x[1], footprint.y[1]), sizeof(MaterialTexel));
+
+		return TextureSampling::BlendTexels(texels, footprint.weights);
+	}
+
+	MaterialSample MaterialTexture::Unpack(uint64_t packedTexel)
+	{
+		MaterialTexel texel{};
+		std::memcpy(&texel, &packedTexel, sizeof(MaterialTexel));
+
+		constexpr float inv255{ 1.f / 255.f };
+		constexpr float normalScale{ 2.f / 255.f };
+
+		MaterialSample sample{};
+		sample.diffuse = { texel.diffuse[0] * inv255, texel.diffuse[1] * inv255, texel.diffuse[2] * inv255 };
+		sample.normal = { texel.normal[0] * normalScale - 1.f, texel.normal[1] * normalScale - 1.f, texel.normal[2] * normalScale - 1.f };
+		sample.specular = texel.specular * inv255;
+		sample.glossiness = texel.glossiness * inv255;
+
+		return sample;
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include "ColorRGB.h"
+#include "MaterialCache.h"
+#include "TextureSampling.h"
+#include "Vector3.h"
+
+namespace dae
+{
+	struct Vector2;
+
+	// Everything the shading needs from the material at one uv
+	struct MaterialSample
+	{
+		ColorRGB diffuse{};
+		// Tangent space, each component in [-1, 1] and not normalized
+		Vector3 normal{};
+		float specular{};
+		float glossiness{};
+	};
+
+	// The diffuse, normal, specular and glossiness maps of a material, sampled from the interleaved texels MaterialCache bakes
+	class MaterialTexture
+	{
+	public:
+		// Loads the material AssetBaker baked next to the diffuse map, see MaterialCache. When that is missing or stale the maps
+		// are decoded and baked here the same way, and the cache is written for the next load. Throws when a map can't be loaded
+		static MaterialTexture* LoadFromFiles(const std::string& diffusePath, const std::string& normalPath, const std::string& specularPath, const std::string& glossinessPath,
+			TextureSampling::TexelLayout layout = TextureSampling::TexelLayout::Tiled);
+
+		// Filtered like the sampler state says, from level 0
+		MaterialSample Sample(const Vector2& uv) const;
+
+		// The same at the level of detail of the uv derivatives of the pixel along x and y. Bilinear filtering blends the two
+		// mip levels around it (trilinear) so levels don't pop, point filtering takes the nearest level
+		MaterialSample Sample(const Vector2& uv, const Vector2& ddx, const Vector2& ddy) const;
+
+		// Bilinear with clamped addressing unless set otherwise
+		void SetSamplerState(const TextureSampling::SamplerState& samplerState) { m_SamplerState = samplerState; }
+		const TextureSampling::SamplerState& GetSamplerState() const { return m_SamplerState; }
+
+		int GetWidth() const { return m_Material.mipLevels[0].width; }
+		int GetHeight() const { return m_Material.mipLevels[0].height; }
+		int GetAmountOfLevels() const { return int(m_Material.mipLevels.size()); }
+
+	private:
+		explicit MaterialTexture(BakedMaterial&& material) : m_Material{ std::move(material) } {}
+
+		// The texel at uv in one mip level, filtered like the sampler state says
+		uint64_t FetchTexel(const Vector2& uv, int level) const;
+		static MaterialSample Unpack(uint64_t texel);
+
+		const MaterialTexel& TexelAt(const BakedMaterial::MipLevel& level, int x, int y) const
+		{
+			return m_Material.texels[level.firstTexel + TextureSampling::GetTexelIndex(x, y, level.width, m_Material.layout)];
+		}
+
+		BakedMaterial m_Material{};
+		TextureSampling::SamplerState m_SamplerState{};
+	};
+}
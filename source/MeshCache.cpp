@@ -0,0 +1,252 @@
+#include "MeshCache.h"
+
+//Standard includes
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+//Project includes
+#include "Bounds.h"
+#include "DataTypes.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "SourceStamp.h"
+#include "Utils.h"
+
+namespace dae
+{
+	namespace MeshCache
+	{
+		// Bump when the layout of the file or of Vertex changes, or when the parser starts producing different data
+		constexpr uint32_t FormatVersion{ 4 };
+		constexpr char Magic[4]{ 'D', 'A', 'E', 'M' };
+
+		// Blobs start on a cache line
+		constexpr uint64_t BlobAlignment{ 64 };
+
+		static_assert(std::is_trivially_copyable_v<Vertex>, "Vertices are stored as raw bytes");
+		static_assert(std::is_trivially_copyable_v<Cluster>, "Clusters are stored as raw bytes");
+
+		// Everything is stored in the native layout of the machine that wrote the file
+		struct Header
+		{
+			char magic[4]{};
+			uint32_t version{};
+			uint32_t vertexSize{};
+			uint32_t clusterSize{};
+			uint32_t flipAxisAndWinding{};
+
+			// Source file at the time the cache was written
+			SourceStamp source{};
+
+			uint64_t amountOfVertices{};
+			uint64_t amountOfIndices{};
+			uint64_t amountOfClusters{};
+			uint64_t amountOfClusterVertices{};
+			uint64_t verticesOffset{};
+			uint64_t indicesOffset{};
+			uint64_t clustersOffset{};
+			uint64_t clusterVerticesOffset{};
+			// One local index per entry of the index buffer
+			uint64_t clusterIndicesOffset{};
+		};
+
+		static uint64_t AlignUp(uint64_t offset)
+		{
+			return (offset + BlobAlignment - 1) & ~(BlobAlignment - 1);
+		}
+
+		// Whether amountOfElements elements starting at offset lie inside the file, without overflowing on a corrupt header
+		static bool IsBlobInFile(uint64_t offset, uint64_t amountOfElements, uint64_t elementSize, uint64_t fileSize)
+		{
+			return offset <= fileSize && amountOfElements <= (fileSize - offset) / elementSize;
+		}
+
+		std::string GetCachePath(const std::string& filename)
+		{
+			return filename + ".meshbin";
+		}
+
+		bool LoadOBJ(const std::string& filename, BakedMesh& mesh, bool flipAxisAndWinding)
+		{
+			if (Read(filename, mesh, flipAxisAndWinding))
+				return true;
+
+			if (!Utils::ParseOBJ(filename, mesh.vertices, mesh.indices, flipAxisAndWinding))
+				return false;
+
+			Optimize(mesh);
+
+			// A cache that can't be written (read only folder) only costs the next start the parse again
+			Write(filename, mesh, flipAxisAndWinding);
+			return true;
+		}
+
+		void Optimize(BakedMesh& mesh)
+		{
+			// Clusters are runs of the triangle list, so they are cut after the triangles are in vertex cache order
+			MeshOptimizer::OptimizeMesh(mesh.vertices, mesh.indices);
+			mesh.clusters = Bounds::BuildClusters(mesh.vertices, mesh.indices);
+			Bounds::BuildClusterVertices(mesh.clusters, mesh.indices, mesh.clusterVertices, mesh.clusterIndices);
+		}
+
+		bool Read(const std::string& filename, BakedMesh& mesh, bool flipAxisAndWinding)
+		{
+			SourceStamp source{};
+			bool isWriteTimeStale{};
+
+			{
+				const MappedFile file{ GetCachePath(filename) };
+				if (!file.IsOpen() || file.GetSize() < sizeof(Header))
+					return false;
+
+				Header header{};
+				std::memcpy(&header, file.GetData(), sizeof(Header));
+
+				if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != FormatVersion
+					|| header.vertexSize != sizeof(Vertex) || header.clusterSize != sizeof(Cluster) || header.flipAxisAndWinding != uint32_t(flipAxisAndWinding))
+					return false;
+
+				if (!header.source.Matches(filename, source))
+					return false;
+
+				isWriteTimeStale = source.writeTime != header.source.writeTime;
+
+				if (header.amountOfIndices % 3 != 0
+					|| !IsBlobInFile(header.verticesOffset, header.amountOfVertices, sizeof(Vertex), file.GetSize())
+					|| !IsBlobInFile(header.indicesOffset, header.amountOfIndices, sizeof(uint32_t), file.GetSize())
+					|| !IsBlobInFile(header.clustersOffset, header.amountOfClusters, sizeof(Cluster), file.GetSize())
+					|| !IsBlobInFile(header.clusterVerticesOffset, header.amountOfClusterVertices, sizeof(uint32_t), file.GetSize())
+					|| !IsBlobInFile(header.clusterIndicesOffset, header.amountOfIndices, sizeof(uint8_t), file.GetSize()))
+					return false;
+
+				// In range by the checks above, so none of these overflow
+				const uint64_t verticesSize = header.amountOfVertices * sizeof(Vertex);
+				const uint64_t indicesSize = header.amountOfIndices * sizeof(uint32_t);
+				const uint64_t clustersSize = header.amountOfClusters * sizeof(Cluster);
+				const uint64_t clusterVerticesSize = header.amountOfClusterVertices * sizeof(uint32_t);
+				const uint64_t clusterIndicesSize = header.amountOfIndices * sizeof(uint8_t);
+
+				// Copied out instead of used in place: Mesh owns its buffers like every mesh built at runtime, the vertices are only
+				// read once more to fill the VertexStream, and a mapping kept alive for the mesh would lock the cache on Windows so
+				// the write time below and a rebake by AssetBaker couldn't update it. The blobs are about 1 MB, a fraction of the load
+				mesh.vertices.resize(header.amountOfVertices);
+				mesh.indices.resize(header.amountOfIndices);
+				mesh.clusters.resize(header.amountOfClusters);
+				mesh.clusterVertices.resize(header.amountOfClusterVertices);
+				mesh.clusterIndices.resize(header.amountOfIndices);
+				std::memcpy(mesh.vertices.data(), file.GetData() + header.verticesOffset, verticesSize);
+				std::memcpy(mesh.indices.data(), file.GetData() + header.indicesOffset, indicesSize);
+				std::memcpy(mesh.clusters.data(), file.GetData() + header.clustersOffset, clustersSize);
+				std::memcpy(mesh.clusterVertices.data(), file.GetData() + header.clusterVerticesOffset, clusterVerticesSize);
+				std::memcpy(mesh.clusterIndices.data(), file.GetData() + header.clusterIndicesOffset, clusterIndicesSize);
+			}
+
+			// The renderer indexes without bounds checks, an index or a cluster reaching outside the buffers
+			// makes the file as unusable as a bad header
+			for (const uint32_t index : mesh.indices)
+			{
+				if (index >= mesh.vertices.size())
+					return false;
+			}
+
+			for (const Cluster& cluster : mesh.clusters)
+			{
+				if (cluster.amountOfIndices % 3 != 0 || cluster.amountOfVertices > Bounds::MaxClusterVertices
+					|| uint64_t(cluster.firstIndex) + cluster.amountOfIndices > mesh.indices.size()
+					|| uint64_t(cluster.firstVertex) + cluster.amountOfVertices > mesh.clusterVertices.size())
+					return false;
+
+				for (uint32_t index{ cluster.firstIndex }; index < cluster.firstIndex + cluster.amountOfIndices; ++index)
+				{
+					if (mesh.clusterIndices[index] >= cluster.amountOfVertices)
+						return false;
+				}
+			}
+
+			for (const uint32_t vertex : mesh.clusterVertices)
+			{
+				if (vertex >= mesh.vertices.size())
+					return false;
+			}
+
+			// Same contents, so only store the new write time and skip hashing on the next load
+			if (isWriteTimeStale)
+			{
+				std::fstream file(GetCachePath(filename), std::ios::binary | std::ios::in | std::ios::out);
+				file.seekp(offsetof(Header, source) + offsetof(SourceStamp, writeTime));
+				file.write(reinterpret_cast<const char*>(&source.writeTime), sizeof(source.writeTime));
+			}
+
+			return true;
+		}
+
+		bool Write(const std::string& filename, const BakedMesh& mesh, bool flipAxisAndWinding)
+		{
+			if (mesh.clusterIndices.size() != mesh.indices.size())
+				return false;
+
+			Header header{};
+			std::memcpy(header.magic, Magic, sizeof(Magic));
+			header.version = FormatVersion;
+			header.vertexSize = sizeof(Vertex);
+			header.clusterSize = sizeof(Cluster);
+			header.flipAxisAndWinding = flipAxisAndWinding;
+
+			if (!SourceStamp::FromFile(filename, header.source, true))
+				return false;
+
+			header.amountOfVertices = mesh.vertices.size();
+			header.amountOfIndices = mesh.indices.size();
+			header.amountOfClusters = mesh.clusters.size();
+			header.amountOfClusterVertices = mesh.clusterVertices.size();
+			header.verticesOffset = AlignUp(sizeof(Header));
+			header.indicesOffset = AlignUp(header.verticesOffset + mesh.vertices.size() * sizeof(Vertex));
+			header.clustersOffset = AlignUp(header.indicesOffset + mesh.indices.size() * sizeof(uint32_t));
+			header.clusterVerticesOffset = AlignUp(header.clustersOffset + mesh.clusters.size() * sizeof(Cluster));
+			header.clusterIndicesOffset = AlignUp(header.clusterVerticesOffset + mesh.clusterVertices.size() * sizeof(uint32_t));
+
+			// Written next to the final file and renamed, so a crash never leaves a half written cache behind
+			const std::string cachePath = GetCachePath(filename);
+			const std::string temporaryPath = cachePath + ".tmp";
+
+			{
+				std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+				if (!file)
+					return false;
+
+				const char padding[BlobAlignment]{};
+
+				// Every blob is padded up to the offset of the next one
+				const auto writeBlob = [&file, &padding](uint64_t offset, uint64_t nextOffset, const void* pData, uint64_t size)
+				{
+					file.write(reinterpret_cast<const char*>(pData), size);
+					file.write(padding, nextOffset - (offset + size));
+				};
+
+				file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+				file.write(padding, header.verticesOffset - sizeof(Header));
+				writeBlob(header.verticesOffset, header.indicesOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+				writeBlob(header.indicesOffset, header.clustersOffset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+				writeBlob(header.clustersOffset, header.clusterVerticesOffset, mesh.clusters.data(), mesh.clusters.size() * sizeof(Cluster));
+				writeBlob(header.clusterVerticesOffset, header.clusterIndicesOffset, mesh.clusterVertices.data(), mesh.clusterVertices.size() * sizeof(uint32_t));
+				file.write(reinterpret_cast<const char*>(mesh.clusterIndices.data()), mesh.clusterIndices.size());
+
+				if (!file)
+					return false;
+			}
+
+			std::error_code error{};
+			std::filesystem::rename(temporaryPath, cachePath, error);
+			if (error)
+			{
+				std::filesystem::remove(temporaryPath, error);
+				return false;
+			}
+
+			return true;
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "DataTypes.h"
+
+namespace dae
+{
+	// A parsed OBJ ready to draw: reordered by MeshOptimizer and split in clusters, see Bounds::BuildClusters
+	struct BakedMesh
+	{
+		std::vector<Vertex> vertices{};
+		std::vector<uint32_t> indices{};
+		std::vector<Cluster> clusters{};
+		std::vector<uint32_t> clusterVertices{};
+		std::vector<uint8_t> clusterIndices{};
+	};
+
+	// Binary copy of a parsed OBJ, deduplicated, reordered by MeshOptimizer, clustered and with the tangents baked in.
+	// Stored next to the source as <file>.meshbin, memory mapped and copied out when it is read back
+	namespace MeshCache
+	{
+		// Loads an OBJ through its cache, the cache is (re)written when it is missing, stale or from an older version
+		bool LoadOBJ(const std::string& filename, BakedMesh& mesh, bool flipAxisAndWinding = true);
+
+		// Turns the vertices and indices of a freshly parsed mesh into what the cache holds, replacing any clusters
+		void Optimize(BakedMesh& mesh);
+
+		// Returns false when the cache doesn't exist or doesn't belong to the current source file
+		bool Read(const std::string& filename, BakedMesh& mesh, bool flipAxisAndWinding = true);
+		bool Write(const std::string& filename, const BakedMesh& mesh, bool flipAxisAndWinding = true);
+
+		std::string GetCachePath(const std::string& filename);
+	}
+}
@@ -0,0 +1,254 @@
+#include "MeshOptimizer.h"
+
+//Standard includes
+#include <algorithm>
+#include <cmath>
+
+//Project includes
+#include "DataTypes.h"
+
+namespace dae
+{
+	namespace MeshOptimizer
+	{
+		// Tuning from Forsyth's "Linear-Speed Vertex Cache Optimisation", the cache is modelled as LRU
+		constexpr int ModelledCacheSize{ 32 };
+		constexpr float CacheDecayPower{ 1.5f };
+		constexpr float LastTriangleScore{ 0.75f };
+		constexpr float ValenceBoostScale{ 2.f };
+		constexpr float ValenceBoostPower{ 0.5f };
+
+		constexpr uint32_t InvalidIndex{ UINT32_MAX };
+
+		// How much emitting a triangle that uses this vertex is worth: more when the vertex is recent in the cache,
+		// and more when it has few triangles left so lone triangles don't get stranded
+		static float VertexScore(int cachePosition, uint32_t amountOfLiveTriangles)
+		{
+			if (amountOfLiveTriangles == 0)
+				return -1.f;
+
+			float score{};
+			if (cachePosition >= 0)
+			{
+				// The vertices of the last triangle get a fixed score, otherwise the same triangle would win again
+				if (cachePosition < 3)
+					score = LastTriangleScore;
+				else
+					score = std::pow(1.f - float(cachePosition - 3) / float(ModelledCacheSize - 3), CacheDecayPower);
+			}
+
+			score += ValenceBoostScale * std::pow(float(amountOfLiveTriangles), -ValenceBoostPower);
+			return score;
+		}
+
+		VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t amountOfVertices, uint32_t cacheSize)
+		{
+			VertexCacheStatistics statistics{};
+			if (indices.size() < 3 || cacheSize == 0)
+				return statistics;
+
+			// A vertex is in the FIFO while fewer than cacheSize misses happened after its own miss
+			std::vector<uint32_t> missTimes(amountOfVertices);
+			uint32_t time{ cacheSize + 1 };
+			uint32_t amountOfMisses{};
+			uint32_t amountOfUsedVertices{};
+
+			for (const uint32_t index : indices)
+			{
+				if (missTimes[index] == 0)
+				{
+					++amountOfUsedVertices;
+				}
+
+				if (time - missTimes[index] > cacheSize)
+				{
+					missTimes[index] = time++;
+					++amountOfMisses;
+				}
+			}
+
+			statistics.acmr = float(amountOfMisses) / float(indices.size() / 3);
+			statistics.atvr = float(amountOfMisses) / float(amountOfUsedVertices);
+			return statistics;
+		}
+
+		void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t amountOfVertices)
+		{
+			const uint32_t amountOfTriangles = uint32_t(indices.size() / 3);
+			if (amountOfTriangles == 0)
+				return;
+
+			// Triangles around every vertex: the live ones of vertex v are the first amountOfLiveTriangles[v] from firstTriangle[v]
+			std::vector<uint32_t> firstTriangle(amountOfVertices + 1);
+			for (const uint32_t index : indices)
+			{
+				++firstTriangle[size_t(index) + 1];
+			}
+
+			std::vector<uint32_t> amountOfLiveTriangles(amountOfVertices);
+			for (size_t vertex{}; vertex < amountOfVertices; ++vertex)
+			{
+				amountOfLiveTriangles[vertex] = firstTriangle[vertex + 1];
+				firstTriangle[vertex + 1] += firstTriangle[vertex];
+			}
+
+			std::vector<uint32_t> vertexTriangles(indices.size());
+			{
+				std::vector<uint32_t> nextSlot(firstTriangle.begin(), firstTriangle.end() - 1);
+				for (size_t corner{}; corner < indices.size(); ++corner)
+				{
+					vertexTriangles[nextSlot[indices[corner]]++] = uint32_t(corner / 3);
+				}
+			}
+
+			std::vector<int> cachePositions(amountOfVertices, -1);
+			std::vector<float> vertexScores(amountOfVertices);
+			for (size_t vertex{}; vertex < amountOfVertices; ++vertex)
+			{
+				vertexScores[vertex] = VertexScore(-1, amountOfLiveTriangles[vertex]);
+			}
+
+			const auto triangleScore = [&](uint32_t triangle)
+			{
+				return vertexScores[indices[3 * size_t(triangle)]] + vertexScores[indices[3 * size_t(triangle) + 1]] + vertexScores[indices[3 * size_t(triangle) + 2]];
+			};
+
+			uint32_t bestTriangle{};
+			float bestScore{ triangleScore(0) };
+			for (uint32_t triangle{ 1 }; triangle < amountOfTriangles; ++triangle)
+			{
+				const float score = triangleScore(triangle);
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = triangle;
+				}
+			}
+
+			std::vector<uint32_t> optimizedIndices{};
+			optimizedIndices.reserve(indices.size());
+			std::vector<bool> isEmitted(amountOfTriangles);
+
+			// Most recent first, with room for the 3 vertices that push older ones out
+			uint32_t cache[ModelledCacheSize + 3]{};
+			int cacheLength{};
+			uint32_t nextUnemittedTriangle{};
+
+			for (uint32_t amountEmitted{}; amountEmitted < amountOfTriangles; ++amountEmitted)
+			{
+				// Nothing in the cache has triangles left, continue with the first one that isn't emitted yet
+				if (bestTriangle == InvalidIndex)
+				{
+					while (isEmitted[nextUnemittedTriangle])
+					{
+						++nextUnemittedTriangle;
+					}
+
+					bestTriangle = nextUnemittedTriangle;
+				}
+
+				const uint32_t triangleVertices[3]{ indices[3 * size_t(bestTriangle)], indices[3 * size_t(bestTriangle) + 1], indices[3 * size_t(bestTriangle) + 2] };
+				optimizedIndices.insert(optimizedIndices.end(), std::begin(triangleVertices), std::end(triangleVertices));
+				isEmitted[bestTriangle] = true;
+
+				// Swap the triangle out of the live range of its vertices
+				for (const uint32_t vertex : triangleVertices)
+				{
+					uint32_t* pLiveBegin = vertexTriangles.data() + firstTriangle[vertex];
+					uint32_t* pLiveEnd = pLiveBegin + amountOfLiveTriangles[vertex];
+					std::iter_swap(std::find(pLiveBegin, pLiveEnd, bestTriangle), pLiveEnd - 1);
+					--amountOfLiveTriangles[vertex];
+				}
+
+				// The triangle moves to the front of the cache, every other vertex moves back
+				uint32_t newCache[ModelledCacheSize + 3]{};
+				int newCacheLength{};
+				for (const uint32_t vertex : triangleVertices)
+				{
+					if (std::find(newCache, newCache + newCacheLength, vertex) == newCache + newCacheLength)
+					{
+						newCache[newCacheLength++] = vertex;
+					}
+				}
+
+				for (int position{}; position < cacheLength; ++position)
+				{
+					const uint32_t vertex = cache[position];
+					if (vertex != triangleVertices[0] && vertex != triangleVertices[1] && vertex != triangleVertices[2])
+					{
+						newCache[newCacheLength++] = vertex;
+					}
+				}
+
+				// Vertices past the modelled size fall out, but their scores still change once more
+				for (int position{}; position < newCacheLength; ++position)
+				{
+					const uint32_t vertex = newCache[position];
+					cachePositions[vertex] = position < ModelledCacheSize ? position : -1;
+					vertexScores[vertex] = VertexScore(cachePositions[vertex], amountOfLiveTriangles[vertex]);
+				}
+
+				// Only triangles around those vertices changed score, the best of them goes next
+				bestTriangle = InvalidIndex;
+				bestScore = -1.f;
+				for (int position{}; position < newCacheLength; ++position)
+				{
+					const uint32_t vertex = newCache[position];
+					for (uint32_t slot{ firstTriangle[vertex] }; slot < firstTriangle[vertex] + amountOfLiveTriangles[vertex]; ++slot)
+					{
+						const uint32_t triangle = vertexTriangles[slot];
+						const float score = triangleScore(triangle);
+						if (score > bestScore)
+						{
+							bestScore = score;
+							bestTriangle = triangle;
+						}
+					}
+				}
+
+				cacheLength = std::min(newCacheLength, ModelledCacheSize);
+				std::copy(newCache, newCache + cacheLength, cache);
+			}
+
+			indices.swap(optimizedIndices);
+		}
+
+		void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{
+			std::vector<uint32_t> remap(vertices.size(), InvalidIndex);
+			uint32_t nextVertex{};
+
+			for (uint32_t& index : indices)
+			{
+				if (remap[index] == InvalidIndex)
+				{
+					remap[index] = nextVertex++;
+				}
+
+				index = remap[index];
+			}
+
+			for (uint32_t& newVertex : remap)
+			{
+				if (newVertex == InvalidIndex)
+				{
+					newVertex = nextVertex++;
+				}
+			}
+
+			std::vector<Vertex> reorderedVertices(vertices.size());
+			for (size_t vertex{}; vertex < vertices.size(); ++vertex)
+			{
+				reorderedVertices[remap[vertex]] = vertices[vertex];
+			}
+
+			vertices.swap(reorderedVertices);
+		}
+
+		void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{
+			OptimizeVertexCache(indices, vertices.size());
+			OptimizeVertexFetch(vertices, indices);
+		}
+	}
+}
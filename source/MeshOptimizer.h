@@ -0,0 +1,37 @@
+#pragma once
+
+//Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dae
+{
+	struct Vertex;
+
+	// Load time reordering of indexed triangle lists, so neighbouring triangles share vertices
+	// and the vertices a triangle gathers lie close together in memory
+	namespace MeshOptimizer
+	{
+		struct VertexCacheStatistics
+		{
+			// Average cache miss ratio, transformed vertices per triangle. 0.5 is the best a regular grid can do, 3 means no reuse at all
+			float acmr{};
+
+			// Average transform to vertex ratio, transformed vertices per vertex that is used. 1 is perfect
+			float atvr{};
+		};
+
+		// Simulates a FIFO post-transform cache of cacheSize vertices over the triangle list
+		VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t amountOfVertices, uint32_t cacheSize = 16);
+
+		// Reorders the triangles with Tom Forsyth's linear-speed vertex cache optimisation, the vertices are left alone
+		void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t amountOfVertices);
+
+		// Renumbers the vertices in the order the triangles first use them, unused vertices move to the back
+		void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+		// Both of the above, triangles first so the vertices follow the new triangle order
+		void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+//Standard includes
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <ppl.h>
+#endif
+
+namespace dae
+{
+	// parallel_for for code that is shared with the command line tools, PPL only exists on Windows.
+	// Elsewhere the range is handed out in batches to one thread per core
+	template<typename Index, typename Function>
+	void ParallelFor(Index first, Index last, const Function& function)
+	{
+#if defined(_MSC_VER)
+		concurrency::parallel_for(first, last, function);
+#else
+		if (last <= first)
+			return;
+
+		const size_t amountOfItems = size_t(last - first);
+		const size_t amountOfThreads = std::min(size_t(std::max(std::thread::hardware_concurrency(), 1u)), amountOfItems);
+
+		// A few batches per thread so uneven items balance out
+		const size_t batchSize = std::max(amountOfItems / (amountOfThreads * 8), size_t(1));
+		std::atomic<size_t> nextItem{};
+
+		const auto worker = [&]()
+		{
+			for (size_t batchStart = nextItem.fetch_add(batchSize); batchStart < amountOfItems; batchStart = nextItem.fetch_add(batchSize))
+			{
+				const size_t batchEnd = std::min(batchStart + batchSize, amountOfItems);
+				for (size_t item{ batchStart }; item < batchEnd; ++item)
+				{
+					function(Index(first + item));
+				}
+			}
+		};
+
+		std::vector<std::thread> threads{};
+		for (size_t thread{ 1 }; thread < amountOfThreads; ++thread)
+		{
+			threads.emplace_back(worker);
+		}
+
+		worker();
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+#endif
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+
+//Project includes
+#include "ColorRGB.h"
+
+namespace dae
+{
+	// Where the channels of a 32 bit pixel with 8 bits per channel live, resolved once from the back buffer
+	// so writing a pixel doesn't have to go through SDL_MapRGB
+	struct PixelFormat
+	{
+		uint32_t redShift{ 16 };
+		uint32_t greenShift{ 8 };
+		uint32_t blueShift{};
+		// Set on every pixel, like SDL_MapRGB does for formats with an alpha channel
+		uint32_t alphaMask{};
+
+		uint32_t Pack(uint8_t r, uint8_t g, uint8_t b) const
+		{
+			return (uint32_t(r) << redShift) | (uint32_t(g) << greenShift) | (uint32_t(b) << blueShift) | alphaMask;
+		}
+
+		// Expects channels in [0, 1], truncates like the static_cast<uint8_t> it replaces
+		uint32_t Pack(const ColorRGB& color) const
+		{
+			return Pack(static_cast<uint8_t>(color.r * 255), static_cast<uint8_t>(color.g * 255), static_cast<uint8_t>(color.b * 255));
+		}
+	};
+}
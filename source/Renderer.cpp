@@ -10,20 +10,201 @@
 #include "Renderer.h"
 #include "Math.h"
 #include "Matrix.h"
-#include "Texture.h"
+#include "MaterialTexture.h"
 #include "Utils.h"
+#include "Bounds.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
 #include "Shading.h"
-#include <ppl.h>
+#include "Parallel.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 using namespace dae;
 
-inline float EdgeFunction(const Vector2& a, const Vector2& b, const Vector2& c)
+// Homogeneous clip planes, a vertex is on the inside when its distance is >= 0
+enum ClipPlane
+{
+	Near,
+	Far,
+	Left,
+	Right,
+	Bottom,
+	Top,
+	AmountOfClipPlanes
+};
+
+// Triangles are only clipped in x and y against a band this many times wider than the screen,
+// whatever pokes out of the screen but stays inside the band is cut off by the bounding box clamp
+constexpr float GuardBand{ 8.f };
+
+static float ClipDistance(const Vector4& position, int plane, float sideScale)
+{
+	switch (plane)
+	{
+	case Near:
+		return position.z;
+	case Far:
+		return position.w - position.z;
+	case Left:
+		return position.x + sideScale * position.w;
+	case Right:
+		return sideScale * position.w - position.x;
+	case Bottom:
+		return position.y + sideScale * position.w;
+	default:
+		return sideScale * position.w - position.y;
+	}
+}
+
+// One bit per clip plane the position is outside of
+static uint8_t ComputeOutCode(const Vector4& position, float sideScale)
+{
+	uint8_t outCode{};
+	for (int plane{}; plane < AmountOfClipPlanes; ++plane)
+	{
+		if (ClipDistance(position, plane, sideScale) < 0.f)
+		{
+			outCode |= 1 << plane;
+		}
+	}
+
+	return outCode;
+}
+
+static Vertex_Out LerpVertex(const Vertex_Out& from, const Vertex_Out& to, float factor)
+{
+	Vertex_Out vertex{};
+	vertex.position = from.position + (to.position - from.position) * factor;
+	vertex.color = ColorRGB::Lerp(from.color, to.color, factor);
+	vertex.uv = from.uv + (to.uv - from.uv) * factor;
+	vertex.normal = from.normal + (to.normal - from.normal) * factor;
+	vertex.tangent = from.tangent + (to.tangent - from.tangent) * factor;
+	vertex.viewDirection = from.viewDirection + (to.viewDirection - from.viewDirection) * factor;
+
+	return vertex;
+}
+
+// Vertices are snapped to 24.8 fixed point before rasterization
+constexpr int SubPixelBits{ 8 };
+constexpr int64_t SubPixelScale{ 1 << SubPixelBits };
+constexpr int64_t HalfPixel{ SubPixelScale / 2 };
+
+struct FixedPointTriangle
+{
+	int64_t x[3]{};
+	int64_t y[3]{};
+
+	// Edge function of the whole triangle, > 0 when it faces the camera
+	int64_t area{};
+
+	// Inclusive range of pixels whose center lies inside the bounding box, not clamped to the screen
+	int minX{};
+	int minY{};
+	int maxX{};
+	int maxY{};
+};
+
+// Snapping makes both triangles that share an edge see exactly the same edge
+static FixedPointTriangle SnapToFixedPoint(const Vertex_Out& vertex1, const Vertex_Out& vertex2, const Vertex_Out& vertex3)
+{
+	FixedPointTriangle triangle{};
+
+	const Vertex_Out* vertices[3]{ &vertex1, &vertex2, &vertex3 };
+	for (int index{}; index < 3; ++index)
+	{
+		triangle.x[index] = std::llround(vertices[index]->position.x * SubPixelScale);
+		triangle.y[index] = std::llround(vertices[index]->position.y * SubPixelScale);
+	}
+
+	const int64_t* x = triangle.x;
+	const int64_t* y = triangle.y;
+
+	triangle.area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+
+	// Pixels are sampled at their center
+	triangle.minX = int((std::min(x[0], std::min(x[1], x[2])) - HalfPixel + SubPixelScale - 1) >> SubPixelBits);
+	triangle.minY = int((std::min(y[0], std::min(y[1], y[2])) - HalfPixel + SubPixelScale - 1) >> SubPixelBits);
+	triangle.maxX = int((std::max(x[0], std::max(x[1], x[2])) - HalfPixel) >> SubPixelBits);
+	triangle.maxY = int((std::max(y[0], std::max(y[1], y[2])) - HalfPixel) >> SubPixelBits);
+
+	return triangle;
+}
+
+// Perspective correct attributes at a pixel center, from the screen space barycentric weights of the pixel
+static Vertex_Out InterpolateFragment(const Triangle_Out& triangle, const float invW[3], float w0, float w1, float w2, int px, int py, float z)
+{
+	const Vertex_Out& vertex1 = triangle.vertices[0];
+	const Vertex_Out& vertex2 = triangle.vertices[1];
+	const Vertex_Out& vertex3 = triangle.vertices[2];
+
+	// Perspective correct weights
+	const float pw0 = w0 * invW[0];
+	const float pw1 = w1 * invW[1];
+	const float pw2 = w2 * invW[2];
+	const float wInterpolated = 1.f / (pw0 + pw1 + pw2);
+
+	// color interpolated
+	ColorRGB interpolatedColor = (vertex1.color * pw0) + (vertex2.color * pw1) + (vertex3.color * pw2);
+	interpolatedColor *= wInterpolated;
+
+	// uv interpolated
+	Vector2 uvInterpolated = (vertex1.uv * pw0) + (vertex2.uv * pw1) + (vertex3.uv * pw2);
+	uvInterpolated *= wInterpolated;
+
+	// normal interpolated
+	Vector3 normalInterpolated = (vertex1.normal * pw0) + (vertex2.normal * pw1) + (vertex3.normal * pw2);
+	normalInterpolated *= wInterpolated;
+	normalInterpolated.Normalize();
+
+	// tangent interpolated
+	Vector3 tangentInterpolated = (vertex1.tangent * pw0) + (vertex2.tangent * pw1) + (vertex3.tangent * pw2);
+	tangentInterpolated *= wInterpolated;
+	tangentInterpolated.Normalize();
+
+	// view dir interpolated
+	Vector3 viewDirInterpolated = (vertex1.viewDirection * pw0) + (vertex2.viewDirection * pw1) + (vertex3.viewDirection * pw2);
+	viewDirInterpolated *= wInterpolated;
+	viewDirInterpolated.Normalize();
+
+	Vertex_Out fragment{};
+	fragment.color = interpolatedColor;
+	fragment.position = Vector4{ px + .5f, py + .5f, z, wInterpolated };
+	fragment.uv = uvInterpolated;
+	fragment.normal = normalInterpolated;
+	fragment.tangent = tangentInterpolated;
+	fragment.viewDirection = viewDirInterpolated;
+
+	return fragment;
+}
+
+// The SIMD raster path needs AVX2 and FMA, and the OS has to save the ymm registers
+static bool IsAVX2Supported()
 {
-	// TODO: look into this math later
+#if defined(_MSC_VER)
+	int cpuInfo[4]{};
+	__cpuid(cpuInfo, 0);
+	if (cpuInfo[0] < 7)
+	{
+		return false;
+	}
+
+	__cpuid(cpuInfo, 1);
+	const bool hasFMA = (cpuInfo[2] & (1 << 12)) != 0;
+	const bool hasOSXSave = (cpuInfo[2] & (1 << 27)) != 0;
+	const bool hasAVX = (cpuInfo[2] & (1 << 28)) != 0;
+	if (!hasFMA || !hasOSXSave || !hasAVX || (_xgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
 
-	// point to side => c - a
-	// side to end => b - a
-	return Vector2::Cross(b - a, c - a);
+	__cpuidex(cpuInfo, 7, 0);
+	return (cpuInfo[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
 }
 
 Renderer::Renderer(SDL_Window* pWindow) :
@@ -36,27 +217,61 @@ Renderer::Renderer(SDL_Window* pWindow) :
 	m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
 	m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
 
-	// Texture maps
-	m_pTextureBuffer = Texture::LoadFromFile("Resources/vehicle_diffuse.png");
-	m_pNormalBuffer = Texture::LoadFromFile("Resources/vehicle_normal.png");
-	m_pSpecularBuffer = Texture::LoadFromFile("Resources/vehicle_specular.png");
-	m_pGlossinessBuffer = Texture::LoadFromFile("Resources/vehicle_gloss.png");
+	// Texture maps, interleaved so a pixel fetches all of them at once
+	m_pMaterial = MaterialTexture::LoadFromFiles("Resources/vehicle_diffuse.png", "Resources/vehicle_normal.png", "Resources/vehicle_specular.png", "Resources/vehicle_gloss.png");
 
 	m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
 
+	// The back buffer is 32 bit with 8 bits per channel, so packing a pixel only takes the shifts
+	m_PixelFormat.redShift = m_pBackBuffer->format->Rshift;
+	m_PixelFormat.greenShift = m_pBackBuffer->format->Gshift;
+	m_PixelFormat.blueShift = m_pBackBuffer->format->Bshift;
+	m_PixelFormat.alphaMask = m_pBackBuffer->format->Amask;
+
 	m_pDepthBufferPixels = new float[m_Width * m_Height];
 
+	m_AmountOfHiZBlocksX = (m_Width + m_HiZBlockSize - 1) / m_HiZBlockSize;
+	m_pHiZBuffer = new float[m_AmountOfHiZBlocksX * ((m_Height + m_HiZBlockSize - 1) / m_HiZBlockSize)];
+	m_pVisibilityBuffer = new VisibilitySample[m_Width * m_Height];
+
+	m_UseAVX2 = IsAVX2Supported();
+	std::cout << "Raster path: " << (m_UseAVX2 ? "AVX2" : "scalar") << "\n";
+
+	// Split the screen in tiles, edge tiles are cut off at the screen border
+	for (int tileY{}; tileY < m_Height; tileY += m_TileSize)
+	{
+		for (int tileX{}; tileX < m_Width; tileX += m_TileSize)
+		{
+			Tile tile{};
+			tile.minX = tileX;
+			tile.minY = tileY;
+			tile.maxX = std::min(tileX + m_TileSize, m_Width);
+			tile.maxY = std::min(tileY + m_TileSize, m_Height);
+
+			m_Tiles.push_back(tile);
+		}
+	}
+
 	//Initialize Camera
 	m_Camera.Initialize((float)m_Width / (float)m_Height, 60.f, { .0f,.0f,-10.f });
 
-	std::vector<Vertex> vertices{};
-	std::vector<uint32_t> indices{};
+	// The cache already holds the mesh optimized and clustered
+	BakedMesh bakedMesh{};
+	MeshCache::LoadOBJ("Resources/vehicle.obj", bakedMesh);
 
-	Utils::ParseOBJ("Resources/vehicle.obj", vertices, indices);
+	const MeshOptimizer::VertexCacheStatistics statistics = MeshOptimizer::AnalyzeVertexCache(bakedMesh.indices, bakedMesh.vertices.size());
+	std::cout << "Resources/vehicle.obj: " << bakedMesh.vertices.size() << " vertices, " << bakedMesh.indices.size() / 3 << " triangles, "
+		<< bakedMesh.clusters.size() << " clusters, ACMR " << statistics.acmr << ", ATVR " << statistics.atvr << "\n";
 
 	Mesh mesh{};
-	mesh.vertices = vertices;
-	mesh.indices = indices;
+	mesh.vertices = std::move(bakedMesh.vertices);
+	mesh.indices = std::move(bakedMesh.indices);
+	mesh.clusters = std::move(bakedMesh.clusters);
+	mesh.clusterVertices = std::move(bakedMesh.clusterVertices);
+	mesh.clusterIndices = std::move(bakedMesh.clusterIndices);
+	mesh.vertexStream.Assign(mesh.vertices);
+	mesh.boundingBox = Bounds::ComputeBoundingBox(mesh.vertices);
+	mesh.boundingSphere = Bounds::ComputeBoundingSphere(mesh.vertices);
 	mesh.primitiveTopology = PrimitiveTopology::TriangleList;
 	mesh.transformMatrix = Matrix::CreateTranslation({ 0,0,50 });
 	mesh.scaleMatrix = Matrix::CreateScale({ 1,1,1 });
@@ -70,10 +285,9 @@ Renderer::Renderer(SDL_Window* pWindow) :
 Renderer::~Renderer()
 {
 	delete[] m_pDepthBufferPixels;
-	delete m_pTextureBuffer;
-	delete m_pNormalBuffer;
-	delete m_pGlossinessBuffer;
-	delete m_pSpecularBuffer;
+	delete[] m_pHiZBuffer;
+	delete[] m_pVisibilityBuffer;
+	delete m_pMaterial;
 }
 
 void Renderer::Update(Timer* pTimer)
@@ -91,97 +305,481 @@ void Renderer::Update(Timer* pTimer)
 	}
 }
 
-void Renderer::Render()
+bool Renderer::Render()
 {
+	const bool shouldRender = !IsLastFrameUpToDate();
+
 	//@START
 	//Lock BackBuffer
-	SDL_LockSurface(m_pBackBuffer);
+	if (shouldRender)
+	{
+		SDL_LockSurface(m_pBackBuffer);
 
-	//Render_W1();
-	RenderFrame();
-	//Render_Test();
+		//Render_W1();
+		RenderFrame();
+		//Render_Test();
 
+		m_RenderedCameraVersion = m_Camera.version;
+		m_RenderedSettingsVersion = m_SettingsVersion;
 
+		SDL_UnlockSurface(m_pBackBuffer);
+	}
 
 	//@END
 	//Update SDL Surface
-	SDL_UnlockSurface(m_pBackBuffer);
 	SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
 	SDL_UpdateWindowSurface(m_pWindow);
+
+	return shouldRender;
+}
+
+bool Renderer::IsLastFrameUpToDate() const
+{
+	if (m_RenderedCameraVersion != m_Camera.version || m_RenderedSettingsVersion != m_SettingsVersion)
+	{
+		return false;
+	}
+
+	// The vertex stage keeps the versions of the last transform, a mesh that moved hasn't been transformed yet
+	for (const Mesh& mesh : m_Meshes)
+	{
+		if (mesh.transformedVersion != mesh.version || mesh.transformedCameraVersion != m_Camera.version)
+		{
+			return false;
+		}
+	}
+
+	return true;
 }
 
 void dae::Renderer::RenderFrame()
 {
-	// Transform from World -> View -> Projected -> Raster
+	// Transform from World -> View -> Projected, the divide to Raster happens after clipping
 	VertexTransformationFunction(m_Meshes);
 
-	// Make float array size of image that will act as depth buffer
-	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
+	// Every tile clears its own part of the buffers in the raster pass
+	m_ClearColor = m_PixelFormat.Pack(100, 100, 100);
 
-	// Clear back buffer
-	SDL_FillRect(m_pBackBuffer, &m_pBackBuffer->clip_rect, SDL_MapRGB(m_pBackBuffer->format, 100, 100, 100));
+	// Setup pass: every task takes a few consecutive clusters, clips their triangles and finds the tiles they overlap
+	m_SetupTasks.clear();
 
 	for (const auto& mesh : m_Meshes)
 	{
+		if (!mesh.isVisible)
+		{
+			continue;
+		}
+
 		if (mesh.primitiveTopology == PrimitiveTopology::TriangleList)
 		{
-			const uint32_t amountOfTriangles = ((uint32_t)mesh.indices.size()) / 3;
-			
-			concurrency::parallel_for(0u, amountOfTriangles, [=, this](int index)
+			uint32_t amountOfTaskTriangles{};
+			for (const Cluster& cluster : mesh.clusters)
 			{
-				const Vertex_Out vertex1 = mesh.vertices_out[mesh.indices[3 * index]];
-				const Vertex_Out vertex2 = mesh.vertices_out[mesh.indices[3 * index + 1]];
-				const Vertex_Out vertex3 = mesh.vertices_out[mesh.indices[3 * index + 2]];
-
-				// cull triangles
-				if (vertex1.position.x < 0 || vertex2.position.x < 0 || vertex3.position.x < 0
-					|| vertex1.position.x > m_Width || vertex2.position.x > m_Width || vertex3.position.x > m_Width
-					|| vertex1.position.y < 0 || vertex2.position.y < 0 || vertex3.position.y < 0
-					|| vertex1.position.y > m_Height || vertex2.position.y > m_Height || vertex3.position.y > m_Height
-					)
+				if (amountOfTaskTriangles == 0)
 				{
-					return;
+					m_SetupTasks.push_back({ &mesh, &cluster, 0 });
 				}
 
-				RenderTriangle(vertex1, vertex2, vertex3);
-			});
+				++m_SetupTasks.back().amountOfClusters;
+				amountOfTaskTriangles += cluster.amountOfIndices / 3;
+
+				if (amountOfTaskTriangles >= m_MinSetupTaskTriangles)
+				{
+					amountOfTaskTriangles = 0;
+				}
+			}
 		}
 		else if (mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
 		{
-			for (uint32_t indice{}; indice < mesh.indices.size() - 2; indice++)
+			m_SetupTasks.push_back({ &mesh, nullptr, 0 });
+		}
+	}
+
+	if (m_SetupBatches.size() < m_SetupTasks.size())
+	{
+		m_SetupBatches.resize(m_SetupTasks.size());
+	}
+
+	ParallelFor(0u, (uint32_t)m_SetupTasks.size(), [this](uint32_t taskIndex)
+	{
+		const SetupTask& task = m_SetupTasks[taskIndex];
+		SetupBatch& batch = m_SetupBatches[taskIndex];
+
+		batch.triangles.clear();
+		batch.tileRanges.clear();
+
+		if (task.pClusters == nullptr)
+		{
+			SetupTriangleStrip(*task.pMesh, batch);
+			return;
+		}
+
+		for (uint32_t index{}; index < task.amountOfClusters; ++index)
+		{
+			const Cluster& cluster = task.pClusters[index];
+			if (!IsClusterCulled(*task.pMesh, cluster))
 			{
-				const Vertex_Out vertex1 = mesh.vertices_out[mesh.indices[indice]];
-				Vertex_Out vertex2{};
-				Vertex_Out vertex3{};
+				SetupCluster(*task.pMesh, cluster, batch);
+			}
+		}
+	});
 
-				if (indice & 1)
-				{
-					vertex2 = mesh.vertices_out[mesh.indices[indice + 2]];
-					vertex3 = mesh.vertices_out[mesh.indices[indice + 1]];
-				}
-				else
-				{
-					vertex2 = mesh.vertices_out[mesh.indices[indice + 1]];
-					vertex3 = mesh.vertices_out[mesh.indices[indice + 2]];
-				}
+	// Batches are merged in task order, so every tile still sees its triangles in submission order
+	uint32_t amountOfTriangles{};
+	for (size_t taskIndex{}; taskIndex < m_SetupTasks.size(); ++taskIndex)
+	{
+		m_SetupBatches[taskIndex].firstTriangle = amountOfTriangles;
+		amountOfTriangles += (uint32_t)m_SetupBatches[taskIndex].triangles.size();
+	}
 
-				if (vertex1.position.x < 0 || vertex2.position.x < 0 || vertex3.position.x < 0
-					|| vertex1.position.x > m_Width || vertex2.position.x > m_Width || vertex3.position.x > m_Width
-					|| vertex1.position.y < 0 || vertex2.position.y < 0 || vertex3.position.y < 0
-					|| vertex1.position.y > m_Height || vertex2.position.y > m_Height || vertex3.position.y > m_Height
-					)
+	m_Triangles.resize(amountOfTriangles);
+
+	ParallelFor(0u, (uint32_t)m_SetupTasks.size(), [this](uint32_t taskIndex)
+	{
+		const SetupBatch& batch = m_SetupBatches[taskIndex];
+		std::copy(batch.triangles.begin(), batch.triangles.end(), m_Triangles.begin() + batch.firstTriangle);
+	});
+
+	for (Tile& tile : m_Tiles)
+	{
+		tile.triangleIndices.clear();
+	}
+
+	const int amountOfTilesX = (m_Width + m_TileSize - 1) / m_TileSize;
+
+	for (size_t taskIndex{}; taskIndex < m_SetupTasks.size(); ++taskIndex)
+	{
+		const SetupBatch& batch = m_SetupBatches[taskIndex];
+
+		for (uint32_t index{}; index < (uint32_t)batch.tileRanges.size(); ++index)
+		{
+			const TileRange& range = batch.tileRanges[index];
+
+			for (int tileY{ range.minY }; tileY <= range.maxY; ++tileY)
+			{
+				for (int tileX{ range.minX }; tileX <= range.maxX; ++tileX)
 				{
-					return;
+					m_Tiles[tileY * amountOfTilesX + tileX].triangleIndices.push_back(batch.firstTriangle + index);
 				}
+			}
+		}
+	}
+
+	// Raster pass: a worker owns a whole tile, so depth and color writes never race
+	// and every pixel sees its triangles in submission order
+	ParallelFor(0u, (uint32_t)m_Tiles.size(), [this](uint32_t tileIndex)
+	{
+		RenderTile(m_Tiles[tileIndex]);
+	});
+}
+
+bool Renderer::IsClusterCulled(const Mesh& mesh, const Cluster& cluster) const
+{
+	if (mesh.localFrustum.IsOutside(cluster.sphere))
+	{
+		return true;
+	}
+
+	// Only when every triangle would be culled one by one in BinTriangle
+	switch (m_CullMode)
+	{
+	case CullMode::Back:
+		return Bounds::IsBackFacing(cluster, mesh.localCameraOrigin);
+	case CullMode::Front:
+		return Bounds::IsFrontFacing(cluster, mesh.localCameraOrigin);
+	default:
+		return false;
+	}
+}
+
+void Renderer::SetupCluster(const Mesh& mesh, const Cluster& cluster, SetupBatch& batch) const
+{
+	// Every vertex of the cluster is classified once, its triangles then only combine the codes of their corners
+	uint8_t frustumOutCodes[Bounds::MaxClusterVertices]{};
+	uint8_t guardBandOutCodes[Bounds::MaxClusterVertices]{};
+
+	const uint32_t* pVertices = mesh.clusterVertices.data() + cluster.firstVertex;
+
+	for (uint32_t localIndex{}; localIndex < cluster.amountOfVertices; ++localIndex)
+	{
+		const Vector4& position = mesh.vertices_out[pVertices[localIndex]].position;
+		frustumOutCodes[localIndex] = ComputeOutCode(position, 1.f);
+		guardBandOutCodes[localIndex] = ComputeOutCode(position, GuardBand);
+	}
+
+	const uint8_t* pLocalIndices = mesh.clusterIndices.data();
+
+	for (uint32_t index{ cluster.firstIndex }; index < cluster.firstIndex + cluster.amountOfIndices; index += 3)
+	{
+		const uint8_t local1 = pLocalIndices[index];
+		const uint8_t local2 = pLocalIndices[index + 1];
+		const uint8_t local3 = pLocalIndices[index + 2];
+
+		if ((frustumOutCodes[local1] & frustumOutCodes[local2] & frustumOutCodes[local3]) != 0)
+		{
+			continue;
+		}
+
+		if ((guardBandOutCodes[local1] | guardBandOutCodes[local2] | guardBandOutCodes[local3]) == 0)
+		{
+			BinTriangle(ToRasterSpace(mesh, pVertices[local1]), ToRasterSpace(mesh, pVertices[local2]), ToRasterSpace(mesh, pVertices[local3]), batch);
+		}
+		else
+		{
+			ClipTriangle(mesh, pVertices[local1], pVertices[local2], pVertices[local3], batch);
+		}
+	}
+}
+
+void Renderer::SetupTriangleStrip(const Mesh& mesh, SetupBatch& batch) const
+{
+	for (uint32_t indice{}; indice < mesh.indices.size() - 2; indice++)
+	{
+		if (indice & 1)
+		{
+			ClipTriangle(mesh, mesh.indices[indice], mesh.indices[indice + 2], mesh.indices[indice + 1], batch);
+		}
+		else
+		{
+			ClipTriangle(mesh, mesh.indices[indice], mesh.indices[indice + 1], mesh.indices[indice + 2], batch);
+		}
+	}
+}
+
+void Renderer::ClipTriangle(const Mesh& mesh, uint32_t index1, uint32_t index2, uint32_t index3, SetupBatch& batch) const
+{
+	const Vertex_Out& vertex1 = mesh.vertices_out[index1];
+	const Vertex_Out& vertex2 = mesh.vertices_out[index2];
+	const Vertex_Out& vertex3 = mesh.vertices_out[index3];
+
+	// Outside the same side of the view frustum, nothing can be visible
+	const uint8_t frustumOutCode1 = ComputeOutCode(vertex1.position, 1.f);
+	const uint8_t frustumOutCode2 = ComputeOutCode(vertex2.position, 1.f);
+	const uint8_t frustumOutCode3 = ComputeOutCode(vertex3.position, 1.f);
+
+	if ((frustumOutCode1 & frustumOutCode2 & frustumOutCode3) != 0)
+	{
+		return;
+	}
+
+	// Only near, far and the guard band need real clipping
+	const uint8_t clipPlanes =
+		ComputeOutCode(vertex1.position, GuardBand) |
+		ComputeOutCode(vertex2.position, GuardBand) |
+		ComputeOutCode(vertex3.position, GuardBand);
+
+	if (clipPlanes == 0)
+	{
+		BinTriangle(ToRasterSpace(mesh, index1), ToRasterSpace(mesh, index2), ToRasterSpace(mesh, index3), batch);
+		return;
+	}
+
+	// Sutherland-Hodgman, every plane can add at most one vertex to the polygon
+	constexpr int maxPolygonSize{ 3 + AmountOfClipPlanes };
+	Vertex_Out polygons[2][maxPolygonSize]{ { vertex1, vertex2, vertex3 } };
+	int polygonSize{ 3 };
+	int current{};
+
+	for (int plane{}; plane < AmountOfClipPlanes; ++plane)
+	{
+		if ((clipPlanes & (1 << plane)) == 0)
+		{
+			continue;
+		}
+
+		const Vertex_Out* pInput = polygons[current];
+		Vertex_Out* pOutput = polygons[1 - current];
+		int outputSize{};
+
+		for (int index{}; index < polygonSize; ++index)
+		{
+			const Vertex_Out& from = pInput[index];
+			const Vertex_Out& to = pInput[(index + 1) % polygonSize];
+
+			const float fromDistance = ClipDistance(from.position, plane, GuardBand);
+			const float toDistance = ClipDistance(to.position, plane, GuardBand);
+
+			if (fromDistance >= 0.f)
+			{
+				pOutput[outputSize++] = from;
+			}
+
+			if ((fromDistance >= 0.f) != (toDistance >= 0.f))
+			{
+				pOutput[outputSize++] = LerpVertex(from, to, fromDistance / (fromDistance - toDistance));
+			}
+		}
+
+		current = 1 - current;
+		polygonSize = outputSize;
+
+		if (polygonSize < 3)
+		{
+			return;
+		}
+	}
+
+	// Triangle fan, keeps the winding of the original triangle
+	const Vertex_Out* pPolygon = polygons[current];
+	const Vertex_Out fanOrigin = ToRasterSpace(pPolygon[0]);
+
+	for (int index{ 1 }; index < polygonSize - 1; ++index)
+	{
+		BinTriangle(fanOrigin, ToRasterSpace(pPolygon[index]), ToRasterSpace(pPolygon[index + 1]), batch);
+	}
+}
+
+Vertex_Out Renderer::ToRasterSpace(const Vertex_Out& vertex) const
+{
+	Vertex_Out rasterVertex = vertex;
+
+	// perspective divide, w is kept for perspective correct interpolation
+	rasterVertex.position.x /= vertex.position.w;
+	rasterVertex.position.y /= vertex.position.w;
+	rasterVertex.position.z /= vertex.position.w;
+
+	// NDC to raster coords
+	rasterVertex.position.x = ((rasterVertex.position.x + 1) * (float)m_Width) / 2.f;
+	rasterVertex.position.y = ((1 - rasterVertex.position.y) * (float)m_Height) / 2.f;
+
+	return rasterVertex;
+}
+
+Vertex_Out Renderer::ToRasterSpace(const Mesh& mesh, uint32_t index) const
+{
+	// The vertex stage already did the divide for every vertex
+	Vertex_Out rasterVertex = mesh.vertices_out[index];
+	rasterVertex.position = mesh.positions_raster[index];
+
+	return rasterVertex;
+}
+
+void Renderer::BinTriangle(const Vertex_Out& vertex1, const Vertex_Out& vertex2, const Vertex_Out& vertex3, SetupBatch& batch) const
+{
+	const FixedPointTriangle fixedTriangle = SnapToFixedPoint(vertex1, vertex2, vertex3);
+
+	// Degenerate after snapping, it can't cover anything
+	if (fixedTriangle.area == 0)
+	{
+		return;
+	}
+
+	const bool isFrontFacing = fixedTriangle.area > 0;
+
+	if ((m_CullMode == CullMode::Back && !isFrontFacing) || (m_CullMode == CullMode::Front && isFrontFacing))
+	{
+		return;
+	}
+
+	// Falls between pixel centers, or inside the guard band but completely next to the screen
+	if (fixedTriangle.minX > fixedTriangle.maxX || fixedTriangle.minY > fixedTriangle.maxY
+		|| fixedTriangle.maxX < 0 || fixedTriangle.maxY < 0 || fixedTriangle.minX >= m_Width || fixedTriangle.minY >= m_Height)
+	{
+		return;
+	}
+
+	// Bounding box in pixels, clamped to the screen
+	const int minX = std::max(fixedTriangle.minX, 0);
+	const int minY = std::max(fixedTriangle.minY, 0);
+	const int maxX = std::min(fixedTriangle.maxX, m_Width - 1);
+	const int maxY = std::min(fixedTriangle.maxY, m_Height - 1);
+
+	// The raster pass only handles a positive area, so kept back faces get their winding flipped
+	if (isFrontFacing)
+	{
+		batch.triangles.push_back({ vertex1, vertex2, vertex3 });
+	}
+	else
+	{
+		batch.triangles.push_back({ vertex1, vertex3, vertex2 });
+	}
+
+	batch.tileRanges.push_back({ minX / m_TileSize, minY / m_TileSize, maxX / m_TileSize, maxY / m_TileSize });
+}
+
+void Renderer::RenderTile(const Tile& tile)
+{
+	// Clear depth and color of this tile
+	for (int py{ tile.minY }; py < tile.maxY; ++py)
+	{
+		std::fill(m_pDepthBufferPixels + py * m_Width + tile.minX, m_pDepthBufferPixels + py * m_Width + tile.maxX, FLT_MAX);
+		std::fill(m_pBackBufferPixels + py * m_Width + tile.minX, m_pBackBufferPixels + py * m_Width + tile.maxX, m_ClearColor);
+	}
+
+	for (int blockY{ tile.minY / m_HiZBlockSize }; blockY * m_HiZBlockSize < tile.maxY; ++blockY)
+	{
+		std::fill(m_pHiZBuffer + blockY * m_AmountOfHiZBlocksX + tile.minX / m_HiZBlockSize, m_pHiZBuffer + blockY * m_AmountOfHiZBlocksX + (tile.maxX + m_HiZBlockSize - 1) / m_HiZBlockSize, FLT_MAX);
+	}
+
+	if (m_IsDeferredShading)
+	{
+		for (int py{ tile.minY }; py < tile.maxY; ++py)
+		{
+			std::fill(m_pVisibilityBuffer + py * m_Width + tile.minX, m_pVisibilityBuffer + py * m_Width + tile.maxX, VisibilitySample{ m_InvalidTriangleIndex });
+		}
+	}
+
+	for (const uint32_t triangleIndex : tile.triangleIndices)
+	{
+		if (m_UseAVX2)
+		{
+			RenderTriangleAVX2(triangleIndex, tile);
+		}
+		else
+		{
+			RenderTriangle(triangleIndex, tile);
+		}
+	}
+
+	// The visibility of this tile is final now, so every covered pixel gets shaded exactly once
+	if (m_IsDeferredShading)
+	{
+		ShadeTile(tile);
+	}
+}
+
+void Renderer::ShadeTile(const Tile& tile)
+{
+	// Neighbouring pixels mostly show the same triangle, its uv gradients are only set up again when it changes
+	uint32_t gradientsTriangleIndex{ m_InvalidTriangleIndex };
+	UVGradients uvGradients{};
+
+	for (int py{ tile.minY }; py < tile.maxY; ++py)
+	{
+		for (int px{ tile.minX }; px < tile.maxX; ++px)
+		{
+			const int pixelIndex = py * m_Width + px;
+			const VisibilitySample& sample = m_pVisibilityBuffer[pixelIndex];
 
-				RenderTriangle(vertex1, vertex2, vertex3);
+			if (sample.triangleIndex == m_InvalidTriangleIndex)
+			{
+				continue;
+			}
+
+			const Triangle_Out& triangle = m_Triangles[sample.triangleIndex];
+			const float invW[3]{ 1.f / triangle.vertices[0].position.w, 1.f / triangle.vertices[1].position.w, 1.f / triangle.vertices[2].position.w };
+			const float w0 = 1.f - sample.weight1 - sample.weight2;
+
+			if (gradientsTriangleIndex != sample.triangleIndex)
+			{
+				gradientsTriangleIndex = sample.triangleIndex;
+				uvGradients = UVGradients::FromTriangle(triangle);
 			}
+
+			const Vertex_Out fragment = InterpolateFragment(triangle, invW, w0, sample.weight1, sample.weight2, px, py, m_pDepthBufferPixels[pixelIndex]);
+
+			Vector2 uvDdx{}, uvDdy{};
+			uvGradients.GetDerivatives(fragment.uv, fragment.position.w, uvDdx, uvDdy);
+
+			WritePixel(px, py, fragment, uvDdx, uvDdy);
 		}
 	}
 }
 
 void Renderer::ToggleDisplayRenderDepthBuffer()
 {
+	++m_SettingsVersion;
+
 	if (m_CurrentCycle != ShadingCycle::DepthMode)
 	{
 		m_LastCycle = m_CurrentCycle;
@@ -199,197 +797,340 @@ void Renderer::VertexTransformationFunction(std::vector<Mesh>& meshes) const
 	// Calculate once
 	for (auto& mesh : meshes)
 	{
+		// vertices_out still holds this mesh seen from this camera
+		if (mesh.transformedVersion == mesh.version && mesh.transformedCameraVersion == m_Camera.version)
+		{
+			continue;
+		}
+
 		Matrix worldMatrix = mesh.scaleMatrix * mesh.rotationMatrix * mesh.transformMatrix;
 		const auto worldViewProjectionMatrix = worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix;
 
-		mesh.vertices_out.clear();
+		// The frustum in mesh space, so the bounds never have to be transformed. A mesh outside of it isn't transformed nor binned
+		mesh.localFrustum = Frustum::FromMatrix(worldViewProjectionMatrix);
+		mesh.localCameraOrigin = Matrix::Inverse(worldMatrix).TransformPoint(m_Camera.origin);
+		mesh.isVisible = !mesh.localFrustum.IsOutside(mesh.boundingSphere) && !mesh.localFrustum.IsOutside(mesh.boundingBox);
 
-		// Loop over indices (every 3 indices is triangle)
-		for (const auto vertex : mesh.vertices)
+		if (mesh.isVisible)
 		{
-			Vertex_Out rasterVertex{};
+			// Every vertex is overwritten by index, so the buffers only allocate when the mesh grows
+			const size_t amountOfVertices = mesh.vertexStream.amountOfVertices;
+			mesh.vertices_out.resize(amountOfVertices);
+			mesh.positions_raster.resize(amountOfVertices);
+
+			// Batches write disjoint ranges of the output, 8 or 4 vertices at a time with the same results as Matrix::TransformPoint and Vector3::Normalize
+			const uint32_t amountOfBatches = uint32_t((amountOfVertices + m_VertexBatchSize - 1) / m_VertexBatchSize);
+			ParallelFor(0u, amountOfBatches, [&](uint32_t batch)
+			{
+				const size_t firstVertex = batch * m_VertexBatchSize;
+				const size_t lastVertex = std::min(firstVertex + m_VertexBatchSize, amountOfVertices);
 
-			
-			auto position = Vector4{ vertex.position, 1 };
+				if (m_UseAVX2)
+				{
+					TransformVertexStreamAVX(mesh, worldMatrix, worldViewProjectionMatrix, firstVertex, lastVertex);
+				}
+				else
+				{
+					TransformVertexStreamSSE(mesh, worldMatrix, worldViewProjectionMatrix, firstVertex, lastVertex);
+				}
+			});
+		}
 
-			// Transform model to raster (screen space)
-			auto transformedVertex =  worldViewProjectionMatrix.TransformPoint(position);
-			rasterVertex.viewDirection = worldMatrix.TransformPoint(vertex.position) - m_Camera.origin;
-	
-			// perspective divide
-			transformedVertex.x /= transformedVertex.w;
-			transformedVertex.y /= transformedVertex.w;
-			transformedVertex.z /= transformedVertex.w;
+		// Visibility only changes when the mesh or the camera does, so a culled mesh is up to date as well
+		mesh.transformedVersion = mesh.version;
+		mesh.transformedCameraVersion = m_Camera.version;
+	}
+}
 
-			// NDC to raster coords
-			transformedVertex.x = ((transformedVertex.x + 1) * (float)m_Width)  / 2.f;
-			transformedVertex.y = ((1 - transformedVertex.y) * (float)m_Height) / 2.f;
+bool Renderer::SetupTriangle(const Triangle_Out& triangle, const Tile& tile, TriangleSetup& setup) const
+{
+	// 1 / SubPixelScale^2, converts fixed point edge values back to pixel units
+	constexpr float fixedToPixelArea{ 1.f / float(SubPixelScale * SubPixelScale) };
 
-			// Add vertex to vertices out and color
-	
-			rasterVertex.position = transformedVertex;
-			rasterVertex.color = vertex.color;
-			rasterVertex.uv = vertex.uv;
+	// Culling already happened in BinTriangle, so the area is positive
+	const FixedPointTriangle fixedTriangle = SnapToFixedPoint(triangle.vertices[0], triangle.vertices[1], triangle.vertices[2]);
+	const int64_t* x = fixedTriangle.x;
+	const int64_t* y = fixedTriangle.y;
 
-			Vector3 transformedNormals = worldMatrix.TransformVector(vertex.normal);
-			transformedNormals.Normalize();
+	setup.minX = std::max(fixedTriangle.minX, tile.minX);
+	setup.minY = std::max(fixedTriangle.minY, tile.minY);
+	setup.maxX = std::min(fixedTriangle.maxX, tile.maxX - 1);
+	setup.maxY = std::min(fixedTriangle.maxY, tile.maxY - 1);
 
-			Vector3 transformedTangent = worldMatrix.TransformVector(vertex.tangent);
-			transformedTangent.Normalize();
+	if (setup.minX > setup.maxX || setup.minY > setup.maxY)
+	{
+		return false;
+	}
 
-			rasterVertex.normal = transformedNormals;
-			rasterVertex.tangent = transformedTangent;
+	// The interpolated depth never gets nearer than the nearest vertex
+	setup.minZ = std::min(triangle.vertices[0].position.z, std::min(triangle.vertices[1].position.z, triangle.vertices[2].position.z));
 
-			mesh.vertices_out.push_back(rasterVertex);
+	// Whole triangle behind what is already drawn in every block it touches
+	bool isOccluded{ true };
+	for (int blockY{ setup.minY & ~(m_HiZBlockSize - 1) }; blockY <= setup.maxY && isOccluded; blockY += m_HiZBlockSize)
+	{
+		for (int blockX{ setup.minX & ~(m_HiZBlockSize - 1) }; blockX <= setup.maxX && isOccluded; blockX += m_HiZBlockSize)
+		{
+			isOccluded = IsHiZBlockOccluded(blockX, blockY, setup.minZ);
 		}
 	}
+
+	if (isOccluded)
+	{
+		return false;
+	}
+
+	const int64_t startX = int64_t(setup.minX) * SubPixelScale + HalfPixel;
+	const int64_t startY = int64_t(setup.minY) * SubPixelScale + HalfPixel;
+
+	// Edge equations w = A * px + B * py + C, set up once so stepping a pixel is a single add
+	// w0 is the edge v1 -> v2, w1 the edge v2 -> v0 and w2 the edge v0 -> v1
+	constexpr int edgeVertices[3][2]{ { 1, 2 }, { 2, 0 }, { 0, 1 } };
+
+	for (int edge{}; edge < 3; ++edge)
+	{
+		const int a = edgeVertices[edge][0];
+		const int b = edgeVertices[edge][1];
+
+		const int64_t deltaX = x[b] - x[a];
+		const int64_t deltaY = y[b] - y[a];
+
+		// Top-left rule: a pixel center exactly on an edge only belongs to the triangle if that edge is a top or a left edge
+		const bool isTopLeft = (deltaY == 0 && deltaX > 0) || deltaY < 0;
+		const int64_t edgeValue = deltaX * (startY - y[a]) - deltaY * (startX - x[a]);
+
+		setup.edgeStartFixed[edge] = edgeValue - (isTopLeft ? 0 : 1);
+		setup.edgeStepXFixed[edge] = -deltaY * SubPixelScale;
+		setup.edgeStepYFixed[edge] = deltaX * SubPixelScale;
+
+		setup.edgeStart[edge] = float(edgeValue) * fixedToPixelArea;
+		setup.edgeStepX[edge] = float(-deltaY) / float(SubPixelScale);
+		setup.edgeStepY[edge] = float(deltaX) / float(SubPixelScale);
+	}
+
+	setup.invArea = 1.f / (float(fixedTriangle.area) * fixedToPixelArea);
+
+	for (int index{}; index < 3; ++index)
+	{
+		setup.z[index] = triangle.vertices[index].position.z;
+		setup.invW[index] = 1.f / triangle.vertices[index].position.w;
+	}
+
+	setup.uvGradients = UVGradients::FromTriangle(triangle);
+
+	return true;
+}
+
+Renderer::UVGradients Renderer::UVGradients::FromTriangle(const Triangle_Out& triangle)
+{
+	const Vector4& p0 = triangle.vertices[0].position;
+	const Vector4& p1 = triangle.vertices[1].position;
+	const Vector4& p2 = triangle.vertices[2].position;
+
+	// Screen space barycentric weights are affine, these are their steps per pixel. w0 makes up the rest of 1
+	const float invArea = 1.f / ((p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x));
+	const float weightSteps[2][3]{
+		{ (p1.y - p2.y) * invArea, (p2.y - p0.y) * invArea, (p0.y - p1.y) * invArea },
+		{ (p2.x - p1.x) * invArea, (p0.x - p2.x) * invArea, (p1.x - p0.x) * invArea },
+	};
+
+	UVGradients gradients{};
+	for (int axis{}; axis < 2; ++axis)
+	{
+		for (int index{}; index < 3; ++index)
+		{
+			const Vertex_Out& vertex = triangle.vertices[index];
+			const float weightStep = weightSteps[axis][index] / vertex.position.w;
+
+			gradients.uOverW[axis] += weightStep * vertex.uv.x;
+			gradients.vOverW[axis] += weightStep * vertex.uv.y;
+			gradients.invW[axis] += weightStep;
+		}
+	}
+
+	return gradients;
 }
 
-void dae::Renderer::RenderTriangle(Vertex_Out vertex1, Vertex_Out vertex2, Vertex_Out vertex3)
+void dae::Renderer::RenderTriangle(uint32_t triangleIndex, const Tile& tile)
 {
-	const Vector2 v0 = Vector2{ vertex1.position.x, vertex1.position.y };
-	const Vector2 v1 = Vector2{ vertex2.position.x, vertex2.position.y };
-	const Vector2 v2 = Vector2{ vertex3.position.x, vertex3.position.y };
+	TriangleSetup setup{};
+	if (!SetupTriangle(m_Triangles[triangleIndex], tile, setup))
+	{
+		return;
+	}
+
+	// Walk the bounding box per HiZ block, skipping blocks where the triangle is behind everything drawn so far
+	for (int blockY{ setup.minY & ~(m_HiZBlockSize - 1) }; blockY <= setup.maxY; blockY += m_HiZBlockSize)
+	{
+		for (int blockX{ setup.minX & ~(m_HiZBlockSize - 1) }; blockX <= setup.maxX; blockX += m_HiZBlockSize)
+		{
+			if (IsHiZBlockOccluded(blockX, blockY, setup.minZ))
+			{
+				continue;
+			}
+
+			if (RenderBlock(triangleIndex, setup, blockX, blockY))
+			{
+				UpdateHiZBlock(blockX, blockY);
+			}
+		}
+	}
+}
 
-	// create and clamp bounding box top left
-	int maxX{}, maxY{};
-	maxX = static_cast<int>(std::max(v0.x, std::max(v1.x, v2.x)));
-	maxY = static_cast<int>(std::max(v0.y, std::max(v1.y, v2.y)));
+bool Renderer::RenderBlock(uint32_t triangleIndex, const TriangleSetup& setup, int blockX, int blockY)
+{
+	const Triangle_Out& triangle = m_Triangles[triangleIndex];
 
-	int minX{}, minY{};
-	minX = static_cast<int>(std::min(v0.x, std::min(v1.x, v2.x)));
-	minY = static_cast<int>(std::min(v0.y, std::min(v1.y, v2.y)));
+	const int minX = std::max(blockX, setup.minX);
+	const int minY = std::max(blockY, setup.minY);
+	const int maxX = std::min(blockX + m_HiZBlockSize - 1, setup.maxX);
+	const int maxY = std::min(blockY + m_HiZBlockSize - 1, setup.maxY);
 
-	minX = std::clamp(minX, 0, m_Width);
-	minY = std::clamp(minY, 0, m_Height);
+	int64_t coverage0Row = setup.CoverageAt(0, minX, minY);
+	int64_t coverage1Row = setup.CoverageAt(1, minX, minY);
+	int64_t coverage2Row = setup.CoverageAt(2, minX, minY);
 
-	maxX = std::clamp(maxX, 0, m_Width);
-	maxY = std::clamp(maxY, 0, m_Height);
+	float edge0Row = setup.EdgeAt(0, minX, minY);
+	float edge1Row = setup.EdgeAt(1, minX, minY);
+	float edge2Row = setup.EdgeAt(2, minX, minY);
 
+	bool hasWrittenDepth{};
 
-	for (int px{ minX }; px <= maxX; ++px)
+	for (int py{ minY }; py <= maxY; ++py)
 	{
-		for (int py{ minY }; py <= maxY; ++py)
+		int64_t coverage0 = coverage0Row;
+		int64_t coverage1 = coverage1Row;
+		int64_t coverage2 = coverage2Row;
+
+		float edge0 = edge0Row;
+		float edge1 = edge1Row;
+		float edge2 = edge2Row;
+
+		coverage0Row += setup.edgeStepYFixed[0];
+		coverage1Row += setup.edgeStepYFixed[1];
+		coverage2Row += setup.edgeStepYFixed[2];
+
+		edge0Row += setup.edgeStepY[0];
+		edge1Row += setup.edgeStepY[1];
+		edge2Row += setup.edgeStepY[2];
+
+		for (int px{ minX }; px <= maxX; ++px,
+			coverage0 += setup.edgeStepXFixed[0], coverage1 += setup.edgeStepXFixed[1], coverage2 += setup.edgeStepXFixed[2],
+			edge0 += setup.edgeStepX[0], edge1 += setup.edgeStepX[1], edge2 += setup.edgeStepX[2])
 		{
-			Vector2 point{ (float)px, (float)py };
+			// In triangle, decided on the exact fixed point values
+			const bool isInTriangle = coverage0 >= 0 && coverage1 >= 0 && coverage2 >= 0;
+
+			if (!isInTriangle)
+			{
+				continue;
+			}
 
 			// Barycentric coordinates
-			float w0 = EdgeFunction(v1, v2, point);
-			float w1 = EdgeFunction(v2, v0, point);
-			float w2 = EdgeFunction(v0, v1, point);
+			const float w0 = edge0 * setup.invArea;
+			const float w1 = edge1 * setup.invArea;
+			const float w2 = edge2 * setup.invArea;
+
+			// Get the hit point Z with the barycentric weights
+			const float z = (w0 * setup.z[0]) + (w1 * setup.z[1]) + (w2 * setup.z[2]);
 
+			if (z < 0 || z > 1)
+			{
+				continue;
+			}
 
-			// In triangle
-			const bool isInTriangle = w0 >= 0 && w1 >= 0 && w2 >= 0;
+			const int pixelZIndex = py * m_Width + px;
 
-			if (isInTriangle)
+			// If new z value of pixel is lower than stored:
+			if (z >= m_pDepthBufferPixels[pixelZIndex])
 			{
-				const float area = w0 + w1 + w2;
-				w0 /= area;
-				w1 /= area;
-				w2 /= area;
+				continue;
+			}
 
+			m_pDepthBufferPixels[pixelZIndex] = z;
+			hasWrittenDepth = true;
 
-				// Get the hit point Z with the barycentric weights
-				float z = 1.f / ((w0 / vertex1.position.z) + (w1 / vertex2.position.z) + (w2 / vertex3.position.z));
+			// Deferred: only remember what is visible, it gets shaded once the whole tile is rasterized
+			if (m_IsDeferredShading)
+			{
+				m_pVisibilityBuffer[pixelZIndex] = { triangleIndex, w1, w2 };
+				continue;
+			}
 
-				if (z < 0 || z > 1)
-				{
-					continue;
-				}
+			const Vertex_Out fragment = InterpolateFragment(triangle, setup.invW, w0, w1, w2, px, py, z);
 
-				const int pixelZIndex = py * m_Width + px;
+			Vector2 uvDdx{}, uvDdy{};
+			setup.uvGradients.GetDerivatives(fragment.uv, fragment.position.w, uvDdx, uvDdy);
 
-				// If new z value of pixel is lower than stored:
-				if (z < m_pDepthBufferPixels[pixelZIndex])
-				{
-					m_pDepthBufferPixels[pixelZIndex] = z;
-					const float wInterpolated = 1.f / ((w0 / vertex1.position.w) + (w1 / vertex2.position.w) + (w2 / vertex3.position.w));
-
-					// color interpolated
-					ColorRGB interpolatedColor = (vertex1.color * (w0 / vertex1.position.w)) + (vertex2.color * (w1 / vertex2.position.w)) + (vertex3.color * (w2 / vertex3.position.w));
-					interpolatedColor *= wInterpolated;
-
-					// uv interpolated
-					Vector2 uvInterpolated = (vertex1.uv * (w0 / vertex1.position.w)) + (vertex2.uv * (w1 / vertex2.position.w)) + (vertex3.uv * (w2 / vertex3.position.w));
-					uvInterpolated *= wInterpolated;
-
-					uvInterpolated.x = std::clamp(uvInterpolated.x, 0.f, 1.f);
-					uvInterpolated.y = std::clamp(uvInterpolated.y, 0.f, 1.f);
-
-					// normal interpolated
-					Vector3 normalInterpolated =
-						(vertex1.normal * (w0 / vertex1.position.w)) +
-						(vertex2.normal * (w1 / vertex2.position.w)) +
-						(vertex3.normal * (w2 / vertex3.position.w));
-					normalInterpolated *= wInterpolated;
-					normalInterpolated.Normalize();
-
-					// tangent interpolated
-					Vector3 tangentInterpolated = (vertex1.tangent * (w0 / vertex1.position.w)) + (vertex2.tangent * (w1 / vertex2.position.w)) + (vertex3.tangent* (w2 / vertex3.position.w));
-					tangentInterpolated *= wInterpolated;
-					tangentInterpolated.Normalize();
-
-					// view dir interpolated
-					Vector3 viewDirInterpolated = (vertex1.viewDirection * (w0 / vertex1.position.w)) + (vertex2.viewDirection * (w1 / vertex2.position.w)) + (vertex3.viewDirection * (w2 / vertex3.position.w));
-					viewDirInterpolated *= wInterpolated;
-					viewDirInterpolated.Normalize();
-
-					Vertex_Out fragmentToShade{};
-					fragmentToShade.color = interpolatedColor;
-					fragmentToShade.position = Vector4{(float)px,(float)py,z, wInterpolated};
-					fragmentToShade.uv = uvInterpolated;
-					fragmentToShade.normal = normalInterpolated;
-					fragmentToShade.tangent = tangentInterpolated;
-					fragmentToShade.viewDirection = viewDirInterpolated;
-
-
-					ColorRGB finalColor{  };
-
-					if (m_CurrentCycle != ShadingCycle::DepthMode)
-					{
-						finalColor = ShadePixel(fragmentToShade);
-					}
-					else
-					{
-						float depthValue = Utils::Remap(z, 0.995f, 1.f);
-						finalColor = { depthValue, depthValue, depthValue };
-					}
-
-					//Update Color in Buffer
-					finalColor.MaxToOne();
-
-					m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-						static_cast<uint8_t>(finalColor.r * 255),
-						static_cast<uint8_t>(finalColor.g * 255),
-						static_cast<uint8_t>(finalColor.b * 255));
-				}
-			}
+			WritePixel(px, py, fragment, uvDdx, uvDdy);
 		}
 	}
+
+	return hasWrittenDepth;
 }
 
-ColorRGB Renderer::ShadePixel(const Vertex_Out& vertex)
+void Renderer::UpdateHiZBlock(int blockX, int blockY)
+{
+	const int maxX = std::min(blockX + m_HiZBlockSize, m_Width);
+	const int maxY = std::min(blockY + m_HiZBlockSize, m_Height);
+
+	float farthestDepth{};
+	for (int py{ blockY }; py < maxY; ++py)
+	{
+		for (int px{ blockX }; px < maxX; ++px)
+		{
+			farthestDepth = std::max(farthestDepth, m_pDepthBufferPixels[py * m_Width + px]);
+		}
+	}
+
+	m_pHiZBuffer[(blockY / m_HiZBlockSize) * m_AmountOfHiZBlocksX + blockX / m_HiZBlockSize] = farthestDepth;
+}
+
+void Renderer::WritePixel(int px, int py, const Vertex_Out& fragment, const Vector2& uvDdx, const Vector2& uvDdy)
+{
+	m_pBackBufferPixels[px + (py * m_Width)] = m_PixelFormat.Pack(ShadeFragment(fragment, uvDdx, uvDdy));
+}
+
+ColorRGB Renderer::ShadeFragment(const Vertex_Out& fragment, const Vector2& uvDdx, const Vector2& uvDdy)
+{
+	ColorRGB finalColor{};
+
+	if (m_CurrentCycle != ShadingCycle::DepthMode)
+	{
+		finalColor = ShadePixel(fragment, uvDdx, uvDdy);
+	}
+	else
+	{
+		const float depthValue = Utils::Remap(fragment.position.z, 0.995f, 1.f);
+		finalColor = { depthValue, depthValue, depthValue };
+	}
+
+	finalColor.MaxToOne();
+
+	return finalColor;
+}
+
+ColorRGB Renderer::ShadePixel(const Vertex_Out& vertex, const Vector2& uvDdx, const Vector2& uvDdy)
 {
 	// Normal map stuff
 	const Vector3 binormal = Vector3::Cross(vertex.normal, vertex.tangent).Normalized();
 	const Matrix tangentSpaceAxis = Matrix{vertex.tangent, binormal, vertex.normal, {0,0,0}};
 
+	// Sample every map in one fetch, from the mip level that fits the size of the pixel on the texture
+	const MaterialSample material = m_pMaterial->Sample(vertex.uv, uvDdx, uvDdy);
+
 	// Sample normal
-	const ColorRGB normalColor = m_pNormalBuffer->Sample(vertex.uv);
-	Vector3 normalSample = { normalColor.r, normalColor.g, normalColor.b };
-	normalSample = 2.f * normalSample - Vector3{1.f, 1.f, 1.f};
-	normalSample = tangentSpaceAxis.TransformPoint(normalSample);
+	Vector3 normalSample = tangentSpaceAxis.TransformPoint(material.normal);
 	normalSample.Normalize();
 
 	// Sample color
-	const ColorRGB color = m_pTextureBuffer->Sample(vertex.uv);
+	const ColorRGB color = material.diffuse;
 
 	// Sample specular
-	const ColorRGB specularColor = m_pSpecularBuffer->Sample(vertex.uv);
+	const ColorRGB specularColor = { material.specular, material.specular, material.specular };
 
 	// Sample glossiness
-	const ColorRGB glossinessColor = m_pGlossinessBuffer->Sample(vertex.uv);
+	const ColorRGB glossinessColor = { material.glossiness, material.glossiness, material.glossiness };
 
 	// Lights
 	const Vector3 lightDirection = { .577f, -.577f, .577f };
@@ -456,6 +1197,8 @@ ColorRGB Renderer::ShadePixel(const Vertex_Out& vertex)
 		}
 		
 		break;
+	case ShadingCycle::DepthMode:
+		// ShadeFragment shows the depth buffer without shading anything
 	case ShadingCycle::ENUM_LENGTH:
 		throw std::runtime_error("Unknown mode, bug in code");
 	}
@@ -463,6 +1206,8 @@ ColorRGB Renderer::ShadePixel(const Vertex_Out& vertex)
 
 void Renderer::ToggleShadingCycle()
 {
+	++m_SettingsVersion;
+
 	const auto shadingCycleIndex = static_cast<int8_t>(m_CurrentCycle);
 	const auto newShadingCycleIndex = (shadingCycleIndex + 1) % static_cast<int8_t>(ShadingCycle::ENUM_LENGTH);
 
@@ -490,6 +1235,52 @@ void Renderer::ToggleShadingCycle()
 	}
 }
 
+void Renderer::ToggleCullMode()
+{
+	++m_SettingsVersion;
+
+	const auto cullModeIndex = static_cast<int8_t>(m_CullMode);
+	const auto newCullModeIndex = (cullModeIndex + 1) % static_cast<int8_t>(CullMode::ENUM_LENGTH);
+
+	m_CullMode = static_cast<CullMode>(newCullModeIndex);
+
+	switch (m_CullMode)
+	{
+	case CullMode::None:
+		std::cout << "Cull mode: None" << "\n";
+		break;
+	case CullMode::Back:
+		std::cout << "Cull mode: Back" << "\n";
+		break;
+	case CullMode::Front:
+		std::cout << "Cull mode: Front" << "\n";
+		break;
+	case CullMode::ENUM_LENGTH:
+		throw std::runtime_error("Unknown mode, bug in code");
+	}
+}
+
+void Renderer::ToggleDeferredShading()
+{
+	++m_SettingsVersion;
+
+	m_IsDeferredShading = !m_IsDeferredShading;
+	std::cout << "Deferred shading: " << (m_IsDeferredShading ? "On" : "Off") << "\n";
+}
+
+void Renderer::ToggleTextureFiltering()
+{
+	++m_SettingsVersion;
+
+	TextureSampling::SamplerState samplerState = m_pMaterial->GetSamplerState();
+	const bool isBilinear = samplerState.filter == TextureSampling::Filter::Bilinear;
+
+	samplerState.filter = isBilinear ? TextureSampling::Filter::Point : TextureSampling::Filter::Bilinear;
+	m_pMaterial->SetSamplerState(samplerState);
+
+	std::cout << "Texture filtering: " << (isBilinear ? "Point" : "Bilinear") << "\n";
+}
+
 bool Renderer::SaveBufferToImage() const
 {
 	return SDL_SaveBMP(m_pBackBuffer, "Rasterizer_ColorBuffer.bmp");
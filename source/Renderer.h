@@ -5,14 +5,16 @@
 
 #include "Camera.h"
 #include "DataTypes.h"
+#include "PixelFormat.h"
 
 struct SDL_Window;
 struct SDL_Surface;
 
 namespace dae
 {
-	class Texture;
+	class MaterialTexture;
 	struct Mesh;
+	struct Cluster;
 	struct Vertex;
 	class Timer;
 	class Scene;
@@ -29,17 +31,24 @@ namespace dae
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
 		void Update(Timer* pTimer);
-		void Render();
+		// Returns false when nothing visible changed since the last frame, the back buffer is then shown again as is
+		bool Render();
 		void RenderFrame();
 
 		void ToggleDisplayRenderDepthBuffer();
 		void ToggleRotationOfModel() { m_ShouldRotateModel = !m_ShouldRotateModel; };
-		void ToggleNormalMap() { m_ShouldDisplayNormalMap = !m_ShouldDisplayNormalMap; };
+		void ToggleNormalMap() { m_ShouldDisplayNormalMap = !m_ShouldDisplayNormalMap; ++m_SettingsVersion; };
 		void ToggleShadingCycle();
+		void ToggleCullMode();
+		void ToggleDeferredShading();
+		void ToggleTextureFiltering();
 
 		bool SaveBufferToImage() const;
 
 	private:
+		// The regression scenes in RendererTests.cpp render their own meshes through the private frame setup
+		friend class RendererTests;
+
 		enum class ShadingCycle
 		{
 			DepthMode,
@@ -50,40 +59,204 @@ namespace dae
 			ENUM_LENGTH,
 		};
 
+		enum class CullMode
+		{
+			None,
+			Back,
+			Front,
+			ENUM_LENGTH,
+		};
+
+		// Screen region owned by a single worker during the raster pass
+		struct Tile
+		{
+			int minX{};
+			int minY{};
+			int maxX{};
+			int maxY{};
+
+			// Indices into m_Triangles, in submission order
+			std::vector<uint32_t> triangleIndices{};
+		};
+
+		static constexpr int m_TileSize{ 64 };
+
+		// Inclusive range of tiles a binned triangle overlaps
+		struct TileRange
+		{
+			int minX{};
+			int minY{};
+			int maxX{};
+			int maxY{};
+		};
+
+		// Work of one task of the setup pass: consecutive clusters of a triangle list, or a whole triangle strip when pClusters is null
+		struct SetupTask
+		{
+			const Mesh* pMesh{};
+			const Cluster* pClusters{};
+			uint32_t amountOfClusters{};
+		};
+
+		// What a setup task leaves behind, merged into m_Triangles and the tiles in task order afterwards
+		struct SetupBatch
+		{
+			std::vector<Triangle_Out> triangles{};
+			std::vector<TileRange> tileRanges{};
+			uint32_t firstTriangle{};
+		};
+
+		// Screen space gradients of u / w, v / w and 1 / w, index 0 along x and 1 along y. The uv derivatives at a pixel
+		// follow from them and the pixel's own uv and w, so mip selection doesn't need the neighbours in its quad
+		struct UVGradients
+		{
+			float uOverW[2]{};
+			float vOverW[2]{};
+			float invW[2]{};
+
+			// Expects the vertices in raster space
+			static UVGradients FromTriangle(const Triangle_Out& triangle);
+
+			void GetDerivatives(const Vector2& uv, float w, Vector2& ddx, Vector2& ddy) const
+			{
+				ddx = Vector2{ (uOverW[0] - uv.x * invW[0]) * w, (vOverW[0] - uv.y * invW[0]) * w };
+				ddy = Vector2{ (uOverW[1] - uv.x * invW[1]) * w, (vOverW[1] - uv.y * invW[1]) * w };
+			}
+		};
+
+		// Per triangle raster state shared by the scalar and the SIMD path
+		struct TriangleSetup
+		{
+			// Inclusive pixel bounds, clamped to the tile
+			int minX{};
+			int minY{};
+			int maxX{};
+			int maxY{};
+
+			// Fixed point edge functions at the center of (minX, minY) and their increments per pixel,
+			// with the top-left rule folded in so a pixel is covered when all three are >= 0
+			int64_t edgeStartFixed[3]{};
+			int64_t edgeStepXFixed[3]{};
+			int64_t edgeStepYFixed[3]{};
+
+			// The same edge functions in pixel units, only used for the barycentric weights
+			float edgeStart[3]{};
+			float edgeStepX[3]{};
+			float edgeStepY[3]{};
+
+			float invArea{};
+			// z / w of the vertices, affine in screen space after the divide so it is interpolated linearly.
+			// Its reciprocal isn't, and blows up for vertices the near plane clipped to z = 0
+			float z[3]{};
+			float invW[3]{};
+
+			// Nearest depth of the whole triangle, used against the HiZ blocks
+			float minZ{};
+
+			UVGradients uvGradients{};
+
+			int64_t CoverageAt(int edge, int px, int py) const
+			{
+				return edgeStartFixed[edge] + (px - minX) * edgeStepXFixed[edge] + (py - minY) * edgeStepYFixed[edge];
+			}
+
+			float EdgeAt(int edge, int px, int py) const
+			{
+				return edgeStart[edge] + (px - minX) * edgeStepX[edge] + (py - minY) * edgeStepY[edge];
+			}
+		};
+
+		// What the raster pass leaves behind for a pixel in deferred mode, the nearest triangle
+		// and the screen space barycentric weights of its 2nd and 3rd vertex
+		struct VisibilitySample
+		{
+			uint32_t triangleIndex{};
+			float weight1{};
+			float weight2{};
+		};
+
+		static constexpr uint32_t m_InvalidTriangleIndex{ UINT32_MAX };
+
+		// Vertices per task of the vertex stage, a multiple of every SIMD width so every task starts on an aligned register
+		static constexpr size_t m_VertexBatchSize{ 4096 };
+
+		// Clusters are grouped into setup tasks of at least this many triangles, a task per cluster costs more to schedule than to run
+		static constexpr uint32_t m_MinSetupTaskTriangles{ 256 };
+
+		// The depth buffer is also kept as the farthest depth per block of 8x8 pixels.
+		// Tiles are a multiple of a block, so a block is only ever touched by one worker
+		static constexpr int m_HiZBlockSize{ 8 };
+
 		SDL_Window* m_pWindow{};
 
 		SDL_Surface* m_pFrontBuffer{ nullptr };
 		SDL_Surface* m_pBackBuffer{ nullptr };
 
 		// Textures
-		Texture* m_pTextureBuffer{ nullptr };
-		Texture* m_pNormalBuffer{ nullptr };
-		Texture* m_pSpecularBuffer{ nullptr };
-		Texture* m_pGlossinessBuffer{ nullptr };
+		MaterialTexture* m_pMaterial{ nullptr };
 
 		uint32_t* m_pSurfacePixels{};
 		uint32_t* m_pBackBufferPixels{};
+		PixelFormat m_PixelFormat{};
 
 		float* m_pDepthBufferPixels{};
+		float* m_pHiZBuffer{};
+		int m_AmountOfHiZBlocksX{};
+		VisibilitySample* m_pVisibilityBuffer{};
 
 		// settings
 		bool m_IsDisplayingDepthBuffer{};
 		bool m_ShouldRotateModel{};
 		bool m_ShouldDisplayNormalMap{};
+		bool m_UseAVX2{};
+		bool m_IsDeferredShading{};
 		ShadingCycle m_CurrentCycle{ShadingCycle::Diffuse};
 		ShadingCycle m_LastCycle{ ShadingCycle::Diffuse };
+		CullMode m_CullMode{ CullMode::Back };
+
+		// Bumped by every setting that changes the image. The frame in the back buffer is reused
+		// while these, the camera version and every mesh version match what it was rendered with
+		uint64_t m_SettingsVersion{ 1 };
+		uint64_t m_RenderedSettingsVersion{};
+		uint64_t m_RenderedCameraVersion{};
 
 		Camera m_Camera{};
 
 		std::vector<Mesh> m_Meshes{};
 
+		// Binning, the batches are kept between frames so the setup pass only allocates when a cluster grows
+		std::vector<SetupTask> m_SetupTasks{};
+		std::vector<SetupBatch> m_SetupBatches{};
+		std::vector<Triangle_Out> m_Triangles{};
+		std::vector<Tile> m_Tiles{};
+		uint32_t m_ClearColor{};
+
 		int m_Width{};
 		int m_Height{};
 		int m_CurrentFrame{};
 
-		//Function that transforms the vertices from the mesh from World space to Screen space
+		//Function that transforms the vertices from the mesh from World space to Clip space
+		bool IsLastFrameUpToDate() const;
 		void VertexTransformationFunction(std::vector<Mesh>& meshes) const; //W2 version
-		void RenderTriangle(Vertex_Out v1, Vertex_Out v2, Vertex_Out v3);
-		ColorRGB ShadePixel(const Vertex_Out& vertex);
+		void TransformVertexStreamSSE(Mesh& mesh, const Matrix& worldMatrix, const Matrix& worldViewProjectionMatrix, size_t firstVertex, size_t lastVertex) const; // RendererSIMD.cpp
+		void TransformVertexStreamAVX(Mesh& mesh, const Matrix& worldMatrix, const Matrix& worldViewProjectionMatrix, size_t firstVertex, size_t lastVertex) const; // RendererSIMD.cpp
+		bool IsClusterCulled(const Mesh& mesh, const Cluster& cluster) const;
+		void SetupCluster(const Mesh& mesh, const Cluster& cluster, SetupBatch& batch) const;
+		void SetupTriangleStrip(const Mesh& mesh, SetupBatch& batch) const;
+		void ClipTriangle(const Mesh& mesh, uint32_t index1, uint32_t index2, uint32_t index3, SetupBatch& batch) const;
+		Vertex_Out ToRasterSpace(const Vertex_Out& vertex) const;
+		Vertex_Out ToRasterSpace(const Mesh& mesh, uint32_t index) const;
+		void BinTriangle(const Vertex_Out& v1, const Vertex_Out& v2, const Vertex_Out& v3, SetupBatch& batch) const;
+		void RenderTile(const Tile& tile);
+		bool SetupTriangle(const Triangle_Out& triangle, const Tile& tile, TriangleSetup& setup) const;
+		void RenderTriangle(uint32_t triangleIndex, const Tile& tile);
+		bool RenderBlock(uint32_t triangleIndex, const TriangleSetup& setup, int blockX, int blockY);
+		void RenderTriangleAVX2(uint32_t triangleIndex, const Tile& tile); // RendererSIMD.cpp
+		void ShadeTile(const Tile& tile);
+		void WritePixel(int px, int py, const Vertex_Out& fragment, const Vector2& uvDdx, const Vector2& uvDdy);
+		ColorRGB ShadeFragment(const Vertex_Out& fragment, const Vector2& uvDdx, const Vector2& uvDdy);
+		bool IsHiZBlockOccluded(int blockX, int blockY, float depth) const { return depth >= m_pHiZBuffer[(blockY / m_HiZBlockSize) * m_AmountOfHiZBlocksX + blockX / m_HiZBlockSize]; }
+		void UpdateHiZBlock(int blockX, int blockY);
+		ColorRGB ShadePixel(const Vertex_Out& vertex, const Vector2& uvDdx, const Vector2& uvDdy);
 	};
 }
@@ -0,0 +1,597 @@
+//External includes
+#include <immintrin.h>
+
+// Std includes
+#include <algorithm>
+#include <bit>
+
+//Project includes
+#include "Renderer.h"
+#include "DataTypes.h"
+
+// MSVC allows AVX2 intrinsics without /arch:AVX2, so the rest of the renderer keeps running on any x64 cpu.
+// Other compilers need the target enabled per function.
+#if defined(_MSC_VER)
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+
+// The vertex stage only needs AVX, and leaving out fma keeps every product and sum rounded like the scalar Matrix code
+#if defined(_MSC_VER)
+#define AVX_TARGET
+#else
+#define AVX_TARGET __attribute__((target("avx")))
+#endif
+
+using namespace dae;
+
+namespace
+{
+	// Amount of interpolated floats in a Vertex_Out, without the position
+	constexpr int AmountOfAttributes{ 14 };
+
+	enum Attribute
+	{
+		ColorR, ColorG, ColorB,
+		U, V,
+		NormalX, NormalY, NormalZ,
+		TangentX, TangentY, TangentZ,
+		ViewDirX, ViewDirY, ViewDirZ,
+	};
+
+	void GatherAttributes(const Vertex_Out& vertex, float* pAttributes)
+	{
+		pAttributes[ColorR] = vertex.color.r;
+		pAttributes[ColorG] = vertex.color.g;
+		pAttributes[ColorB] = vertex.color.b;
+		pAttributes[U] = vertex.uv.x;
+		pAttributes[V] = vertex.uv.y;
+		pAttributes[NormalX] = vertex.normal.x;
+		pAttributes[NormalY] = vertex.normal.y;
+		pAttributes[NormalZ] = vertex.normal.z;
+		pAttributes[TangentX] = vertex.tangent.x;
+		pAttributes[TangentY] = vertex.tangent.y;
+		pAttributes[TangentZ] = vertex.tangent.z;
+		pAttributes[ViewDirX] = vertex.viewDirection.x;
+		pAttributes[ViewDirY] = vertex.viewDirection.y;
+		pAttributes[ViewDirZ] = vertex.viewDirection.z;
+	}
+
+	AVX2_TARGET void Normalize(__m256& x, __m256& y, __m256& z)
+	{
+		const __m256 magnitude = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_add_ps(_mm256_mul_ps(y, y), _mm256_mul_ps(z, z))));
+		x = _mm256_div_ps(x, magnitude);
+		y = _mm256_div_ps(y, magnitude);
+		z = _mm256_div_ps(z, magnitude);
+	}
+
+	// 8 colors in [0, 1] to 32 bit pixels, truncated like PixelFormat::Pack
+	AVX2_TARGET __m256i PackPixels(__m256 r, __m256 g, __m256 b, const PixelFormat& format)
+	{
+		const __m256 scale = _mm256_set1_ps(255.f);
+		const __m256i red = _mm256_sll_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(r, scale)), _mm_cvtsi32_si128(int(format.redShift)));
+		const __m256i green = _mm256_sll_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(g, scale)), _mm_cvtsi32_si128(int(format.greenShift)));
+		const __m256i blue = _mm256_sll_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(b, scale)), _mm_cvtsi32_si128(int(format.blueShift)));
+
+		return _mm256_or_si256(_mm256_or_si256(red, green), _mm256_or_si256(blue, _mm256_set1_epi32(int(format.alphaMask))));
+	}
+}
+
+AVX2_TARGET void Renderer::RenderTriangleAVX2(uint32_t triangleIndex, const Tile& tile)
+{
+	const Triangle_Out& triangle = m_Triangles[triangleIndex];
+
+	TriangleSetup setup{};
+	if (!SetupTriangle(triangle, tile, setup))
+	{
+		return;
+	}
+
+	constexpr int laneCount{ 8 };
+	static_assert(laneCount == m_HiZBlockSize, "A row of a HiZ block is handled as one register");
+	const __m256 laneIndices = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.f);
+
+	// Edge offsets of every lane relative to the first pixel of a block.
+	// Coverage uses the 64 bit fixed point edges, split over a low (lanes 0-3) and a high (lanes 4-7) register
+	__m256 edgeLaneOffsets[3]{};
+	__m256i coverageLaneOffsetsLow[3]{};
+	__m256i coverageLaneOffsetsHigh[3]{};
+	__m256i coverageRowSteps[3]{};
+	for (int edge{}; edge < 3; ++edge)
+	{
+		const int64_t step = setup.edgeStepXFixed[edge];
+
+		edgeLaneOffsets[edge] = _mm256_mul_ps(laneIndices, _mm256_set1_ps(setup.edgeStepX[edge]));
+		coverageLaneOffsetsLow[edge] = _mm256_setr_epi64x(0, step, 2 * step, 3 * step);
+		coverageLaneOffsetsHigh[edge] = _mm256_setr_epi64x(4 * step, 5 * step, 6 * step, 7 * step);
+		coverageRowSteps[edge] = _mm256_set1_epi64x(setup.edgeStepYFixed[edge]);
+	}
+
+	const __m256i minusOne = _mm256_set1_epi64x(-1);
+
+	const __m256 invArea = _mm256_set1_ps(setup.invArea);
+	const __m256 z0 = _mm256_set1_ps(setup.z[0]);
+	const __m256 z1 = _mm256_set1_ps(setup.z[1]);
+	const __m256 z2 = _mm256_set1_ps(setup.z[2]);
+	const __m256 invW0 = _mm256_set1_ps(setup.invW[0]);
+	const __m256 invW1 = _mm256_set1_ps(setup.invW[1]);
+	const __m256 invW2 = _mm256_set1_ps(setup.invW[2]);
+
+	float vertexAttributes[3][AmountOfAttributes]{};
+	for (int vertex{}; vertex < 3; ++vertex)
+	{
+		GatherAttributes(triangle.vertices[vertex], vertexAttributes[vertex]);
+	}
+
+	alignas(32) float interpolated[AmountOfAttributes][laneCount]{};
+	alignas(32) float depths[laneCount]{};
+	alignas(32) float wInterpolatedLanes[laneCount]{};
+	alignas(32) float weights1[laneCount]{};
+	alignas(32) float weights2[laneCount]{};
+	alignas(32) float shaded[3][laneCount]{};
+	alignas(32) float uvDerivatives[4][laneCount]{};
+
+	const UVGradients& uvGradients = setup.uvGradients;
+
+	// Walk the bounding box per HiZ block, skipping blocks where the triangle is behind everything drawn so far
+	for (int blockY{ setup.minY & ~(m_HiZBlockSize - 1) }; blockY <= setup.maxY; blockY += m_HiZBlockSize)
+	{
+		for (int blockX{ setup.minX & ~(m_HiZBlockSize - 1) }; blockX <= setup.maxX; blockX += m_HiZBlockSize)
+		{
+			if (IsHiZBlockOccluded(blockX, blockY, setup.minZ))
+			{
+				continue;
+			}
+
+			const int minY = std::max(blockY, setup.minY);
+			const int maxY = std::min(blockY + m_HiZBlockSize - 1, setup.maxY);
+
+			// Lanes outside the bounding box never touch memory
+			const __m256 inBounds = _mm256_and_ps(
+				_mm256_cmp_ps(laneIndices, _mm256_set1_ps(float(setup.minX - blockX)), _CMP_GE_OQ),
+				_mm256_cmp_ps(laneIndices, _mm256_set1_ps(float(setup.maxX - blockX)), _CMP_LE_OQ));
+
+			__m256i coverageLow[3]{};
+			__m256i coverageHigh[3]{};
+			float edgeRow[3]{};
+			for (int edge{}; edge < 3; ++edge)
+			{
+				const __m256i rowStart = _mm256_set1_epi64x(setup.CoverageAt(edge, blockX, minY));
+				coverageLow[edge] = _mm256_add_epi64(rowStart, coverageLaneOffsetsLow[edge]);
+				coverageHigh[edge] = _mm256_add_epi64(rowStart, coverageLaneOffsetsHigh[edge]);
+
+				edgeRow[edge] = setup.EdgeAt(edge, blockX, minY);
+			}
+
+			bool hasWrittenDepth{};
+
+			for (int py{ minY }; py <= maxY; ++py)
+			{
+				// In triangle, decided on the exact fixed point values
+				__m256i insideLow = _mm256_cmpgt_epi64(coverageLow[0], minusOne);
+				__m256i insideHigh = _mm256_cmpgt_epi64(coverageHigh[0], minusOne);
+				for (int edge{ 1 }; edge < 3; ++edge)
+				{
+					insideLow = _mm256_and_si256(insideLow, _mm256_cmpgt_epi64(coverageLow[edge], minusOne));
+					insideHigh = _mm256_and_si256(insideHigh, _mm256_cmpgt_epi64(coverageHigh[edge], minusOne));
+				}
+
+				// Pack the 2x4 64 bit masks into one 8x32 bit mask in lane order
+				const __m256 inside = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(
+					_mm256_shuffle_ps(_mm256_castsi256_ps(insideLow), _mm256_castsi256_ps(insideHigh), _MM_SHUFFLE(2, 0, 2, 0))),
+					_MM_SHUFFLE(3, 1, 2, 0)));
+
+				const __m256 e0 = _mm256_add_ps(_mm256_set1_ps(edgeRow[0]), edgeLaneOffsets[0]);
+				const __m256 e1 = _mm256_add_ps(_mm256_set1_ps(edgeRow[1]), edgeLaneOffsets[1]);
+				const __m256 e2 = _mm256_add_ps(_mm256_set1_ps(edgeRow[2]), edgeLaneOffsets[2]);
+
+				for (int edge{}; edge < 3; ++edge)
+				{
+					coverageLow[edge] = _mm256_add_epi64(coverageLow[edge], coverageRowSteps[edge]);
+					coverageHigh[edge] = _mm256_add_epi64(coverageHigh[edge], coverageRowSteps[edge]);
+					edgeRow[edge] += setup.edgeStepY[edge];
+				}
+
+				__m256 mask = _mm256_and_ps(inBounds, inside);
+
+				if (_mm256_movemask_ps(mask) == 0)
+				{
+					continue;
+				}
+
+				// Barycentric coordinates
+				const __m256 w0 = _mm256_mul_ps(e0, invArea);
+				const __m256 w1 = _mm256_mul_ps(e1, invArea);
+				const __m256 w2 = _mm256_mul_ps(e2, invArea);
+
+				// Get the hit point Z with the barycentric weights
+				const __m256 z = _mm256_add_ps(_mm256_mul_ps(w0, z0), _mm256_add_ps(_mm256_mul_ps(w1, z1), _mm256_mul_ps(w2, z2)));
+
+				// Depth test
+				float* pDepth = m_pDepthBufferPixels + py * m_Width + blockX;
+				const __m256 storedDepth = _mm256_maskload_ps(pDepth, _mm256_castps_si256(inBounds));
+
+				mask = _mm256_and_ps(mask, _mm256_cmp_ps(z, zero, _CMP_GE_OQ));
+				mask = _mm256_and_ps(mask, _mm256_cmp_ps(z, one, _CMP_LE_OQ));
+				mask = _mm256_and_ps(mask, _mm256_cmp_ps(z, storedDepth, _CMP_LT_OQ));
+
+				int laneMask = _mm256_movemask_ps(mask);
+				if (laneMask == 0)
+				{
+					continue;
+				}
+
+				_mm256_maskstore_ps(pDepth, _mm256_castps_si256(mask), z);
+				hasWrittenDepth = true;
+
+				// Deferred: only remember what is visible, it gets shaded once the whole tile is rasterized
+				if (m_IsDeferredShading)
+				{
+					_mm256_store_ps(weights1, w1);
+					_mm256_store_ps(weights2, w2);
+
+					VisibilitySample* pVisibility = m_pVisibilityBuffer + py * m_Width + blockX;
+					while (laneMask != 0)
+					{
+						const int lane = std::countr_zero(static_cast<uint32_t>(laneMask));
+						laneMask &= laneMask - 1;
+
+						pVisibility[lane] = { triangleIndex, weights1[lane], weights2[lane] };
+					}
+
+					continue;
+				}
+
+				// Perspective correct weights
+				const __m256 pw0 = _mm256_mul_ps(w0, invW0);
+				const __m256 pw1 = _mm256_mul_ps(w1, invW1);
+				const __m256 pw2 = _mm256_mul_ps(w2, invW2);
+				const __m256 wInterpolated = _mm256_div_ps(one, _mm256_add_ps(pw0, _mm256_add_ps(pw1, pw2)));
+
+				__m256 attributes[AmountOfAttributes]{};
+				for (int attribute{}; attribute < AmountOfAttributes; ++attribute)
+				{
+					const __m256 sum = _mm256_add_ps(
+						_mm256_mul_ps(_mm256_set1_ps(vertexAttributes[0][attribute]), pw0),
+						_mm256_add_ps(
+							_mm256_mul_ps(_mm256_set1_ps(vertexAttributes[1][attribute]), pw1),
+							_mm256_mul_ps(_mm256_set1_ps(vertexAttributes[2][attribute]), pw2)));
+
+					attributes[attribute] = _mm256_mul_ps(sum, wInterpolated);
+				}
+
+				Normalize(attributes[NormalX], attributes[NormalY], attributes[NormalZ]);
+				Normalize(attributes[TangentX], attributes[TangentY], attributes[TangentZ]);
+				Normalize(attributes[ViewDirX], attributes[ViewDirY], attributes[ViewDirZ]);
+
+				for (int attribute{}; attribute < AmountOfAttributes; ++attribute)
+				{
+					_mm256_store_ps(interpolated[attribute], attributes[attribute]);
+				}
+
+				_mm256_store_ps(depths, z);
+				_mm256_store_ps(wInterpolatedLanes, wInterpolated);
+
+				// d(uv)/dx = (d(uv / w)/dx - uv * d(1 / w)/dx) * w, the same for y
+				for (int axis{}; axis < 2; ++axis)
+				{
+					const __m256 invWStep = _mm256_set1_ps(uvGradients.invW[axis]);
+					const __m256 du = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(uvGradients.uOverW[axis]), _mm256_mul_ps(attributes[U], invWStep)), wInterpolated);
+					const __m256 dv = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(uvGradients.vOverW[axis]), _mm256_mul_ps(attributes[V], invWStep)), wInterpolated);
+
+					_mm256_store_ps(uvDerivatives[2 * axis], du);
+					_mm256_store_ps(uvDerivatives[2 * axis + 1], dv);
+				}
+
+				// Shade the visible lanes
+				while (laneMask != 0)
+				{
+					const int lane = std::countr_zero(static_cast<uint32_t>(laneMask));
+					laneMask &= laneMask - 1;
+
+					Vertex_Out fragmentToShade{};
+					fragmentToShade.color = { interpolated[ColorR][lane], interpolated[ColorG][lane], interpolated[ColorB][lane] };
+					fragmentToShade.position = Vector4{ blockX + lane + .5f, py + .5f, depths[lane], wInterpolatedLanes[lane] };
+					fragmentToShade.uv = { interpolated[U][lane], interpolated[V][lane] };
+					fragmentToShade.normal = { interpolated[NormalX][lane], interpolated[NormalY][lane], interpolated[NormalZ][lane] };
+					fragmentToShade.tangent = { interpolated[TangentX][lane], interpolated[TangentY][lane], interpolated[TangentZ][lane] };
+					fragmentToShade.viewDirection = { interpolated[ViewDirX][lane], interpolated[ViewDirY][lane], interpolated[ViewDirZ][lane] };
+
+					const Vector2 uvDdx{ uvDerivatives[0][lane], uvDerivatives[1][lane] };
+					const Vector2 uvDdy{ uvDerivatives[2][lane], uvDerivatives[3][lane] };
+
+					const ColorRGB color = ShadeFragment(fragmentToShade, uvDdx, uvDdy);
+					shaded[0][lane] = color.r;
+					shaded[1][lane] = color.g;
+					shaded[2][lane] = color.b;
+				}
+
+				// Lanes that weren't shaded hold stale colors, the mask keeps them out of the back buffer
+				const __m256i pixels = PackPixels(_mm256_load_ps(shaded[0]), _mm256_load_ps(shaded[1]), _mm256_load_ps(shaded[2]), m_PixelFormat);
+				_mm256_maskstore_epi32(reinterpret_cast<int*>(m_pBackBufferPixels + py * m_Width + blockX), _mm256_castps_si256(mask), pixels);
+			}
+
+			if (hasWrittenDepth)
+			{
+				UpdateHiZBlock(blockX, blockY);
+			}
+		}
+	}
+}
+
+namespace
+{
+	// What the vertex stage computes per lane, the rest of a Vertex_Out is copied from the stream
+	enum TransformedComponent
+	{
+		ClipX, ClipY, ClipZ, ClipW,
+		RasterX, RasterY, RasterZ,
+		WorldNormalX, WorldNormalY, WorldNormalZ,
+		WorldTangentX, WorldTangentY, WorldTangentZ,
+		ViewDirectionX, ViewDirectionY, ViewDirectionZ,
+		AmountOfTransformedComponents,
+	};
+
+	// pTransformed holds laneCount values per TransformedComponent
+	void WriteTransformedVertices(Mesh& mesh, size_t firstVertex, size_t amountOfVertices, const float* pTransformed, size_t laneCount)
+	{
+		const VertexStream& stream = mesh.vertexStream;
+		const float* pColorR = stream.GetComponent(VertexStream::ColorR);
+		const float* pColorG = stream.GetComponent(VertexStream::ColorG);
+		const float* pColorB = stream.GetComponent(VertexStream::ColorB);
+		const float* pU = stream.GetComponent(VertexStream::U);
+		const float* pV = stream.GetComponent(VertexStream::V);
+
+		for (size_t lane{}; lane < amountOfVertices; ++lane)
+		{
+			const size_t index = firstVertex + lane;
+			const auto get = [&](TransformedComponent component) { return pTransformed[component * laneCount + lane]; };
+
+			// Member by member, the Vector constructors live in their own translation units and don't inline here
+			Vertex_Out& vertex = mesh.vertices_out[index];
+			vertex.position.x = get(ClipX);
+			vertex.position.y = get(ClipY);
+			vertex.position.z = get(ClipZ);
+			vertex.position.w = get(ClipW);
+			vertex.color.r = pColorR[index];
+			vertex.color.g = pColorG[index];
+			vertex.color.b = pColorB[index];
+			vertex.uv.x = pU[index];
+			vertex.uv.y = pV[index];
+			vertex.normal.x = get(WorldNormalX);
+			vertex.normal.y = get(WorldNormalY);
+			vertex.normal.z = get(WorldNormalZ);
+			vertex.tangent.x = get(WorldTangentX);
+			vertex.tangent.y = get(WorldTangentY);
+			vertex.tangent.z = get(WorldTangentZ);
+			vertex.viewDirection.x = get(ViewDirectionX);
+			vertex.viewDirection.y = get(ViewDirectionY);
+			vertex.viewDirection.z = get(ViewDirectionZ);
+
+			Vector4& rasterPosition = mesh.positions_raster[index];
+			rasterPosition.x = get(RasterX);
+			rasterPosition.y = get(RasterY);
+			rasterPosition.z = get(RasterZ);
+			rasterPosition.w = get(ClipW);
+		}
+	}
+
+	// m0 * x + m1 * y + m2 * z summed left to right like Matrix::TransformVector, so both round the same way
+	__m128 TransformComponentSSE(__m128 x, __m128 y, __m128 z, __m128 m0, __m128 m1, __m128 m2)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m1, y)), _mm_mul_ps(m2, z));
+	}
+
+	AVX_TARGET __m256 TransformComponentAVX(__m256 x, __m256 y, __m256 z, __m256 m0, __m256 m1, __m256 m2)
+	{
+		return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, x), _mm256_mul_ps(m1, y)), _mm256_mul_ps(m2, z));
+	}
+
+	// Same order of operations as Vector3::Normalize
+	void NormalizeSSE(__m128& x, __m128& y, __m128& z)
+	{
+		const __m128 magnitude = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+		x = _mm_div_ps(x, magnitude);
+		y = _mm_div_ps(y, magnitude);
+		z = _mm_div_ps(z, magnitude);
+	}
+
+	AVX_TARGET void NormalizeAVX(__m256& x, __m256& y, __m256& z)
+	{
+		const __m256 magnitude = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+		x = _mm256_div_ps(x, magnitude);
+		y = _mm256_div_ps(y, magnitude);
+		z = _mm256_div_ps(z, magnitude);
+	}
+}
+
+void Renderer::TransformVertexStreamSSE(Mesh& mesh, const Matrix& worldMatrix, const Matrix& worldViewProjectionMatrix, size_t firstVertex, size_t lastVertex) const
+{
+	constexpr size_t laneCount{ 4 };
+	const VertexStream& stream = mesh.vertexStream;
+
+	// Every matrix element broadcast to all lanes, [row][column]
+	__m128 world[4][4]{};
+	__m128 worldViewProjection[4][4]{};
+	for (int row{}; row < 4; ++row)
+	{
+		for (int column{}; column < 4; ++column)
+		{
+			world[row][column] = _mm_set1_ps(worldMatrix[row][column]);
+			worldViewProjection[row][column] = _mm_set1_ps(worldViewProjectionMatrix[row][column]);
+		}
+	}
+
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 half = _mm_set1_ps(.5f);
+	const __m128 width = _mm_set1_ps(float(m_Width));
+	const __m128 height = _mm_set1_ps(float(m_Height));
+	const __m128 cameraOrigin[3]{ _mm_set1_ps(m_Camera.origin.x), _mm_set1_ps(m_Camera.origin.y), _mm_set1_ps(m_Camera.origin.z) };
+
+	const float* pComponents[VertexStream::ENUM_LENGTH]{};
+	for (int component{}; component < VertexStream::ENUM_LENGTH; ++component)
+	{
+		pComponents[component] = stream.GetComponent(VertexStream::Component(component));
+	}
+
+	alignas(16) float transformed[AmountOfTransformedComponents][laneCount];
+
+	// The stream is padded to whole registers, lanes past the last vertex are computed but not written out
+	for (size_t first{ firstVertex }; first < lastVertex; first += laneCount)
+	{
+		const __m128 positionX = _mm_load_ps(pComponents[VertexStream::PositionX] + first);
+		const __m128 positionY = _mm_load_ps(pComponents[VertexStream::PositionY] + first);
+		const __m128 positionZ = _mm_load_ps(pComponents[VertexStream::PositionZ] + first);
+
+		// Model to clip space, the position has w = 1 so the last row is added as is
+		__m128 clip[4]{};
+		for (int column{}; column < 4; ++column)
+		{
+			clip[column] = _mm_add_ps(TransformComponentSSE(positionX, positionY, positionZ,
+				worldViewProjection[0][column], worldViewProjection[1][column], worldViewProjection[2][column]), worldViewProjection[3][column]);
+			_mm_store_ps(transformed[ClipX + column], clip[column]);
+		}
+
+		// Perspective divide and viewport like ToRasterSpace, only used when the triangle doesn't need clipping
+		const __m128 ndcX = _mm_div_ps(clip[0], clip[3]);
+		const __m128 ndcY = _mm_div_ps(clip[1], clip[3]);
+		_mm_store_ps(transformed[RasterX], _mm_mul_ps(_mm_mul_ps(_mm_add_ps(ndcX, one), width), half));
+		_mm_store_ps(transformed[RasterY], _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(one, ndcY), height), half));
+		_mm_store_ps(transformed[RasterZ], _mm_div_ps(clip[2], clip[3]));
+
+		for (int column{}; column < 3; ++column)
+		{
+			const __m128 worldPosition = _mm_add_ps(TransformComponentSSE(positionX, positionY, positionZ,
+				world[0][column], world[1][column], world[2][column]), world[3][column]);
+			_mm_store_ps(transformed[ViewDirectionX + column], _mm_sub_ps(worldPosition, cameraOrigin[column]));
+		}
+
+		const __m128 normalX = _mm_load_ps(pComponents[VertexStream::NormalX] + first);
+		const __m128 normalY = _mm_load_ps(pComponents[VertexStream::NormalY] + first);
+		const __m128 normalZ = _mm_load_ps(pComponents[VertexStream::NormalZ] + first);
+		__m128 worldNormal[3]{};
+		for (int column{}; column < 3; ++column)
+		{
+			worldNormal[column] = TransformComponentSSE(normalX, normalY, normalZ, world[0][column], world[1][column], world[2][column]);
+		}
+
+		NormalizeSSE(worldNormal[0], worldNormal[1], worldNormal[2]);
+
+		const __m128 tangentX = _mm_load_ps(pComponents[VertexStream::TangentX] + first);
+		const __m128 tangentY = _mm_load_ps(pComponents[VertexStream::TangentY] + first);
+		const __m128 tangentZ = _mm_load_ps(pComponents[VertexStream::TangentZ] + first);
+		__m128 worldTangent[3]{};
+		for (int column{}; column < 3; ++column)
+		{
+			worldTangent[column] = TransformComponentSSE(tangentX, tangentY, tangentZ, world[0][column], world[1][column], world[2][column]);
+		}
+
+		NormalizeSSE(worldTangent[0], worldTangent[1], worldTangent[2]);
+
+		for (int column{}; column < 3; ++column)
+		{
+			_mm_store_ps(transformed[WorldNormalX + column], worldNormal[column]);
+			_mm_store_ps(transformed[WorldTangentX + column], worldTangent[column]);
+		}
+
+		WriteTransformedVertices(mesh, first, std::min(laneCount, lastVertex - first), &transformed[0][0], laneCount);
+	}
+}
+
+AVX_TARGET void Renderer::TransformVertexStreamAVX(Mesh& mesh, const Matrix& worldMatrix, const Matrix& worldViewProjectionMatrix, size_t firstVertex, size_t lastVertex) const
+{
+	constexpr size_t laneCount{ 8 };
+	const VertexStream& stream = mesh.vertexStream;
+
+	// Every matrix element broadcast to all lanes, [row][column]
+	__m256 world[4][4]{};
+	__m256 worldViewProjection[4][4]{};
+	for (int row{}; row < 4; ++row)
+	{
+		for (int column{}; column < 4; ++column)
+		{
+			world[row][column] = _mm256_set1_ps(worldMatrix[row][column]);
+			worldViewProjection[row][column] = _mm256_set1_ps(worldViewProjectionMatrix[row][column]);
+		}
+	}
+
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 half = _mm256_set1_ps(.5f);
+	const __m256 width = _mm256_set1_ps(float(m_Width));
+	const __m256 height = _mm256_set1_ps(float(m_Height));
+	const __m256 cameraOrigin[3]{ _mm256_set1_ps(m_Camera.origin.x), _mm256_set1_ps(m_Camera.origin.y), _mm256_set1_ps(m_Camera.origin.z) };
+
+	const float* pComponents[VertexStream::ENUM_LENGTH]{};
+	for (int component{}; component < VertexStream::ENUM_LENGTH; ++component)
+	{
+		pComponents[component] = stream.GetComponent(VertexStream::Component(component));
+	}
+
+	alignas(32) float transformed[AmountOfTransformedComponents][laneCount];
+
+	// The stream is padded to whole registers, lanes past the last vertex are computed but not written out
+	for (size_t first{ firstVertex }; first < lastVertex; first += laneCount)
+	{
+		const __m256 positionX = _mm256_load_ps(pComponents[VertexStream::PositionX] + first);
+		const __m256 positionY = _mm256_load_ps(pComponents[VertexStream::PositionY] + first);
+		const __m256 positionZ = _mm256_load_ps(pComponents[VertexStream::PositionZ] + first);
+
+		// Model to clip space, the position has w = 1 so the last row is added as is
+		__m256 clip[4]{};
+		for (int column{}; column < 4; ++column)
+		{
+			clip[column] = _mm256_add_ps(TransformComponentAVX(positionX, positionY, positionZ,
+				worldViewProjection[0][column], worldViewProjection[1][column], worldViewProjection[2][column]), worldViewProjection[3][column]);
+			_mm256_store_ps(transformed[ClipX + column], clip[column]);
+		}
+
+		// Perspective divide and viewport like ToRasterSpace, only used when the triangle doesn't need clipping
+		const __m256 ndcX = _mm256_div_ps(clip[0], clip[3]);
+		const __m256 ndcY = _mm256_div_ps(clip[1], clip[3]);
+		_mm256_store_ps(transformed[RasterX], _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(ndcX, one), width), half));
+		_mm256_store_ps(transformed[RasterY], _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(one, ndcY), height), half));
+		_mm256_store_ps(transformed[RasterZ], _mm256_div_ps(clip[2], clip[3]));
+
+		for (int column{}; column < 3; ++column)
+		{
+			const __m256 worldPosition = _mm256_add_ps(TransformComponentAVX(positionX, positionY, positionZ,
+				world[0][column], world[1][column], world[2][column]), world[3][column]);
+			_mm256_store_ps(transformed[ViewDirectionX + column], _mm256_sub_ps(worldPosition, cameraOrigin[column]));
+		}
+
+		const __m256 normalX = _mm256_load_ps(pComponents[VertexStream::NormalX] + first);
+		const __m256 normalY = _mm256_load_ps(pComponents[VertexStream::NormalY] + first);
+		const __m256 normalZ = _mm256_load_ps(pComponents[VertexStream::NormalZ] + first);
+		__m256 worldNormal[3]{};
+		for (int column{}; column < 3; ++column)
+		{
+			worldNormal[column] = TransformComponentAVX(normalX, normalY, normalZ, world[0][column], world[1][column], world[2][column]);
+		}
+
+		NormalizeAVX(worldNormal[0], worldNormal[1], worldNormal[2]);
+
+		const __m256 tangentX = _mm256_load_ps(pComponents[VertexStream::TangentX] + first);
+		const __m256 tangentY = _mm256_load_ps(pComponents[VertexStream::TangentY] + first);
+		const __m256 tangentZ = _mm256_load_ps(pComponents[VertexStream::TangentZ] + first);
+		__m256 worldTangent[3]{};
+		for (int column{}; column < 3; ++column)
+		{
+			worldTangent[column] = TransformComponentAVX(tangentX, tangentY, tangentZ, world[0][column], world[1][column], world[2][column]);
+		}
+
+		NormalizeAVX(worldTangent[0], worldTangent[1], worldTangent[2]);
+
+		for (int column{}; column < 3; ++column)
+		{
+			_mm256_store_ps(transformed[WorldNormalX + column], worldNormal[column]);
+			_mm256_store_ps(transformed[WorldTangentX + column], worldTangent[column]);
+		}
+
+		// The write out is compiled without AVX, dirty upper halves would make every one of its SSE instructions pay a transition
+		_mm256_zeroupper();
+		WriteTransformedVertices(mesh, first, std::min(laneCount, lastVertex - first), &transformed[0][0], laneCount);
+	}
+}
@@ -0,0 +1,191 @@
+// Regression scenes for the Renderer, rendered once in a hidden window with every raster path this CPU has. Run by CTest
+// with SDL's dummy video driver, from the source folder so Resources/ is found.
+// Usage: RendererTests [test]... runs the named scenes, or all of them when none are given
+
+//External includes
+#include "SDL.h"
+#undef main
+
+//Standard includes
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+//Project includes
+#include "Bounds.h"
+#include "DataTypes.h"
+#include "Renderer.h"
+
+namespace dae
+{
+	// Friend of Renderer, so the scenes can render their own meshes through the private frame setup
+	class RendererTests final
+	{
+	public:
+		explicit RendererTests(Renderer& renderer) : m_Renderer{ renderer } {}
+
+		// A wall crossing the near plane has to be drawn, the vertices clipped onto it end up with z = 0
+		bool RenderNearPlaneScene();
+
+	private:
+		// One frame of meshes seen from the origin along +z with culling off, the scene set up before is restored afterwards
+		void RenderTestFrame(const std::vector<Mesh>& meshes, bool useAVX2);
+
+		Renderer& m_Renderer;
+	};
+
+	// A triangle list set up like the meshes the renderer loads, in world space
+	static Mesh CreateTestMesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices)
+	{
+		Mesh mesh{};
+		mesh.vertices = std::move(vertices);
+		mesh.indices = std::move(indices);
+		mesh.clusters = Bounds::BuildClusters(mesh.vertices, mesh.indices);
+		Bounds::BuildClusterVertices(mesh.clusters, mesh.indices, mesh.clusterVertices, mesh.clusterIndices);
+		mesh.vertexStream.Assign(mesh.vertices);
+		mesh.boundingBox = Bounds::ComputeBoundingBox(mesh.vertices);
+		mesh.boundingSphere = Bounds::ComputeBoundingSphere(mesh.vertices);
+		mesh.transformMatrix = Matrix::CreateTranslation({ 0,0,0 });
+		mesh.scaleMatrix = Matrix::CreateScale({ 1,1,1 });
+		mesh.rotationMatrix = Matrix::CreateRotationY(0.f);
+		mesh.worldMatrix = mesh.scaleMatrix * mesh.rotationMatrix * mesh.transformMatrix;
+
+		return mesh;
+	}
+
+	void RendererTests::RenderTestFrame(const std::vector<Mesh>& meshes, bool useAVX2)
+	{
+		Renderer& renderer = m_Renderer;
+
+		std::vector<Mesh> sceneMeshes = std::move(renderer.m_Meshes);
+		const Camera camera = renderer.m_Camera;
+		const bool sceneUseAVX2 = renderer.m_UseAVX2;
+		const Renderer::CullMode cullMode = renderer.m_CullMode;
+
+		renderer.m_Meshes = meshes;
+		renderer.m_UseAVX2 = useAVX2;
+		renderer.m_CullMode = Renderer::CullMode::None;
+
+		renderer.m_Camera.Initialize((float)renderer.m_Width / (float)renderer.m_Height, 60.f, { .0f,.0f,.0f });
+		renderer.m_Camera.CalculateViewMatrix();
+		renderer.m_Camera.CalculateProjectionMatrix();
+		++renderer.m_Camera.version;
+
+		SDL_LockSurface(renderer.m_pBackBuffer);
+		renderer.RenderFrame();
+		SDL_UnlockSurface(renderer.m_pBackBuffer);
+
+		renderer.m_Meshes = std::move(sceneMeshes);
+		renderer.m_Camera = camera;
+		renderer.m_UseAVX2 = sceneUseAVX2;
+		renderer.m_CullMode = cullMode;
+		++renderer.m_SettingsVersion;
+	}
+
+	bool RendererTests::RenderNearPlaneScene()
+	{
+		// A wall right of the camera running from behind it to far in front of it, so every triangle crosses
+		// the near plane and the vertices clipped onto it end up with z = 0
+		const std::vector<Mesh> meshes{ CreateTestMesh({
+			Vertex{ { .5f, -50.f, -50.f }, colors::White, { 0.f, 0.f }, { -1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f } },
+			Vertex{ { .5f, 50.f, -50.f }, colors::White, { 0.f, 1.f }, { -1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f } },
+			Vertex{ { .5f, -50.f, 50.f }, colors::White, { 1.f, 0.f }, { -1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f } },
+			Vertex{ { .5f, 50.f, 50.f }, colors::White, { 1.f, 1.f }, { -1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f } },
+		}, { 0, 1, 2, 2, 1, 3 }) };
+
+		bool hasPassed{ true };
+
+		for (const bool useAVX2 : { false, true })
+		{
+			if (useAVX2 && !m_Renderer.m_UseAVX2)
+			{
+				continue;
+			}
+
+			RenderTestFrame(meshes, useAVX2);
+
+			// The wall covers the right half of the screen
+			const float* pDepthBuffer = m_Renderer.m_pDepthBufferPixels;
+			const int amountOfPixels = m_Renderer.m_Width * m_Renderer.m_Height;
+			const int amountOfDrawnPixels = (int)std::count_if(pDepthBuffer, pDepthBuffer + amountOfPixels, [](float depth) { return depth != FLT_MAX; });
+
+			std::cout << "  " << (useAVX2 ? "AVX2" : "scalar") << " path: " << amountOfDrawnPixels << " pixels drawn\n";
+
+			hasPassed = hasPassed && amountOfDrawnPixels >= amountOfPixels / 4;
+		}
+
+		return hasPassed;
+	}
+}
+
+using namespace dae;
+
+namespace
+{
+	using TestFunction = bool (RendererTests::*)();
+
+	struct Test
+	{
+		const char* name;
+		TestFunction function;
+	};
+
+	const Test Tests[]
+	{
+		{ "near_plane", &RendererTests::RenderNearPlaneScene },
+	};
+}
+
+int main(int argc, char* args[])
+{
+	SDL_Init(SDL_INIT_VIDEO);
+
+	SDL_Window* pWindow = SDL_CreateWindow("RendererTests", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 640, 480, SDL_WINDOW_HIDDEN);
+	if (!pWindow)
+	{
+		std::cout << "Failed to create a window: " << SDL_GetError() << "\n";
+		SDL_Quit();
+		return 1;
+	}
+
+	int amountOfFailures{};
+	int amountOfRuns{};
+
+	{
+		Renderer renderer{ pWindow };
+		RendererTests scenes{ renderer };
+
+		for (const Test& test : Tests)
+		{
+			bool isSelected = argc < 2;
+			for (int arg{ 1 }; arg < argc; ++arg)
+			{
+				isSelected |= std::strcmp(args[arg], test.name) == 0;
+			}
+
+			if (!isSelected)
+				continue;
+
+			std::cout << test.name << "\n";
+			const bool isPassed = (scenes.*test.function)();
+			std::cout << (isPassed ? "  passed\n" : "  FAILED\n");
+
+			amountOfFailures += !isPassed;
+			++amountOfRuns;
+		}
+	}
+
+	SDL_DestroyWindow(pWindow);
+	SDL_Quit();
+
+	if (amountOfRuns == 0)
+	{
+		std::cout << "No scene matches the given names\n";
+		return 1;
+	}
+
+	return amountOfFailures;
+}
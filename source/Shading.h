@@ -16,7 +16,7 @@ namespace Shading
 	{
 		const auto reflect = (2.f * (dae::Vector3::Dot(n, l) * n)) - l;
 		const auto angle = std::max(0.f, dae::Vector3::Dot(reflect, v));
-		const auto reflection = ks * std::powf(angle, exp.r);
+		const auto reflection = ks * std::pow(angle, exp.r);
 
 		// return reflection for all color
 		return dae::ColorRGB{ reflection.r, reflection.g, reflection.b };
@@ -0,0 +1,54 @@
+#include "SourceStamp.h"
+
+//Standard includes
+#include <filesystem>
+
+//Project includes
+#include "MappedFile.h"
+
+namespace dae
+{
+	static bool HashFile(const std::string& filename, uint64_t& hash)
+	{
+		const MappedFile file{ filename };
+		if (!file.IsOpen())
+			return false;
+
+		hash = 0xcbf29ce484222325ull;
+		const unsigned char* pData = reinterpret_cast<const unsigned char*>(file.GetData());
+		for (size_t index{}; index < file.GetSize(); ++index)
+		{
+			hash = (hash ^ pData[index]) * 0x100000001b3ull;
+		}
+
+		return true;
+	}
+
+	bool SourceStamp::FromFile(const std::string& filename, SourceStamp& stamp, bool shouldHash)
+	{
+		std::error_code error{};
+		stamp.size = std::filesystem::file_size(filename, error);
+		if (error)
+			return false;
+
+		stamp.writeTime = std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+		if (error)
+			return false;
+
+		return !shouldHash || HashFile(filename, stamp.hash);
+	}
+
+	bool SourceStamp::Matches(const std::string& filename, SourceStamp& current) const
+	{
+		if (!FromFile(filename, current, false) || current.size != size)
+			return false;
+
+		if (current.writeTime == writeTime)
+		{
+			current.hash = hash;
+			return true;
+		}
+
+		return HashFile(filename, current.hash) && current.hash == hash;
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <string>
+
+namespace dae
+{
+	// Identifies the contents of a source file that a baked or cached asset was made from
+	struct SourceStamp
+	{
+		uint64_t size{};
+		int64_t writeTime{};
+
+		// 64 bit FNV-1a over the whole file
+		uint64_t hash{};
+
+		// Hashing reads the whole file, so it is only done when asked for
+		static bool FromFile(const std::string& filename, SourceStamp& stamp, bool shouldHash);
+
+		// True when the file still has the stamped contents, current receives the stamp of the file as it is now.
+		// A different write time alone doesn't mean different contents, a fresh checkout touches every file, so then the file is hashed.
+		// Callers can store current when its write time differs, to skip the hash next time
+		bool Matches(const std::string& filename, SourceStamp& current) const;
+	};
+}
@@ -0,0 +1,233 @@
+// Headless checks for the parts of the Rasterizer that don't need a window, run by CTest.
+// Usage: Tests [test]... runs the named tests, or all of them when none are given, from the source folder so Resources/ is found
+
+//Standard includes
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+//Project includes
+#include "Bounds.h"
+#include "DataTypes.h"
+#include "MaterialCache.h"
+#include "MeshCache.h"
+#include "TextureSampling.h"
+#include "Utils.h"
+
+using namespace dae;
+
+namespace
+{
+	using TestFunction = bool(*)();
+
+	struct Test
+	{
+		const char* name;
+		TestFunction function;
+	};
+
+	bool Check(bool condition, const std::string& message)
+	{
+		if (!condition)
+		{
+			std::cout << "  " << message << "\n";
+		}
+		return condition;
+	}
+
+	// Clusters are cut only when full, so on average they should nearly hit one of the two limits.
+	// The last cluster of a mesh takes whatever is left and is left out
+	bool CheckClusterFill(const std::string& filename)
+	{
+		BakedMesh mesh{};
+		if (!Check(Utils::ParseOBJ(filename, mesh.vertices, mesh.indices), "Failed to parse " + filename))
+			return false;
+
+		MeshCache::Optimize(mesh);
+		if (!Check(mesh.clusters.size() > 1, filename + " has fewer than 2 clusters"))
+			return false;
+
+		double fillSum{};
+		for (size_t index{}; index + 1 < mesh.clusters.size(); ++index)
+		{
+			const Cluster& cluster = mesh.clusters[index];
+			const double vertexFill = double(cluster.amountOfVertices) / Bounds::MaxClusterVertices;
+			const double triangleFill = double(cluster.amountOfIndices / 3) / Bounds::MaxClusterTriangles;
+			fillSum += std::max(vertexFill, triangleFill);
+		}
+
+		const double averageFill = fillSum / double(mesh.clusters.size() - 1);
+		std::cout << "  " << filename << ": " << mesh.clusters.size() << " clusters, " << mesh.indices.size() / 3
+			<< " triangles, average fill " << averageFill << "\n";
+
+		return Check(averageFill >= .9, filename + " clusters are filled to " + std::to_string(averageFill) + " of their limits on average");
+	}
+
+	bool TestClusterFill()
+	{
+		const bool isVehicleFilled = CheckClusterFill("Resources/vehicle.obj");
+		const bool isTuktukFilled = CheckClusterFill("Resources/tuktuk.obj");
+		return isVehicleFilled && isTuktukFilled;
+	}
+
+	BakedTexture MakeMap(int width, int height, uint32_t seed)
+	{
+		BakedTexture map{};
+		BakedTexture::MipLevel& level = map.mipLevels.emplace_back();
+		level.width = width;
+		level.height = height;
+		level.texels.resize(size_t(width) * height);
+
+		for (uint32_t& texel : level.texels)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			texel = seed;
+		}
+
+		return map;
+	}
+
+	// The baked material has to hold the maps' own texels and mip chains, interleaved and in the tiled layout the sampler reads
+	bool TestMaterialBake()
+	{
+		constexpr int width{ 6 };
+		constexpr int height{ 5 };
+
+		// The normal map is smaller and gets resampled to the size of the diffuse map
+		const BakedTexture maps[MaterialCache::AmountOfMaps]{ MakeMap(width, height, 1), MakeMap(3, 2, 2), MakeMap(width, height, 3), MakeMap(width, height, 4) };
+
+		BakedMaterial material{};
+		if (!Check(MaterialCache::Bake(maps, TextureSampling::TexelLayout::Tiled, material), "Bake failed"))
+			return false;
+
+		if (!Check(material.mipLevels.size() == 3, "Expected 3 mip levels for 6x5, got " + std::to_string(material.mipLevels.size())))
+			return false;
+
+		bool isPassed{ true };
+
+		const BakedMaterial::MipLevel& level = material.mipLevels[0];
+		for (int y{}; y < height; ++y)
+		{
+			for (int x{}; x < width; ++x)
+			{
+				const MaterialTexel& texel = material.texels[level.firstTexel + TextureSampling::GetTexelIndex(x, y, width, material.layout)];
+				const uint32_t diffuse = maps[0].mipLevels[0].texels[size_t(y) * width + x];
+				const uint32_t normal = maps[1].mipLevels[0].texels[size_t(y * 2 / height) * 3 + x * 3 / width];
+				const uint32_t specular = maps[2].mipLevels[0].texels[size_t(y) * width + x];
+				const uint32_t glossiness = maps[3].mipLevels[0].texels[size_t(y) * width + x];
+
+				bool isMatching = texel.specular == uint8_t(specular) && texel.glossiness == uint8_t(glossiness);
+				for (int channel{}; channel < 3; ++channel)
+				{
+					isMatching = isMatching && texel.diffuse[channel] == uint8_t(diffuse >> (8 * channel)) && texel.normal[channel] == uint8_t(normal >> (8 * channel));
+				}
+
+				isPassed = Check(isMatching, "Texel (" + std::to_string(x) + ", " + std::to_string(y) + ") of level 0 differs from the maps") && isPassed;
+			}
+		}
+
+		// The 1x1 level is the end of each map's own chain
+		BakedTexture diffuseChain = maps[0];
+		MaterialCache::BuildMipChain(diffuseChain);
+
+		const MaterialTexel& lastTexel = material.texels[material.mipLevels.back().firstTexel];
+		const uint32_t lastDiffuse = diffuseChain.mipLevels.back().texels[0];
+		for (int channel{}; channel < 3; ++channel)
+		{
+			isPassed = Check(lastTexel.diffuse[channel] == uint8_t(lastDiffuse >> (8 * channel)), "Diffuse of the 1x1 level differs from the diffuse map's chain") && isPassed;
+		}
+
+		return isPassed;
+	}
+
+	// uv outside of [0, 1]: wrapping repeats the texture, clamping keeps the edge texels
+	bool TestTextureAddressing()
+	{
+		using TextureSampling::AddressMode;
+
+		constexpr int size{ 8 };
+		bool isPassed{ true };
+
+		isPassed = Check(TextureSampling::ApplyAddressMode(-1, size, AddressMode::Wrap) == size - 1, "Wrap of -1 isn't the last texel") && isPassed;
+		isPassed = Check(TextureSampling::ApplyAddressMode(2 * size + 3, size, AddressMode::Wrap) == 3, "Wrap of 2 * size + 3 isn't texel 3") && isPassed;
+		isPassed = Check(TextureSampling::ApplyAddressMode(-5, size, AddressMode::Clamp) == 0, "Clamp of -5 isn't the first texel") && isPassed;
+		isPassed = Check(TextureSampling::ApplyAddressMode(size + 2, size, AddressMode::Clamp) == size - 1, "Clamp of size + 2 isn't the last texel") && isPassed;
+
+		// Texel centers, so uv and uv + 1 or - 1 land on the same texel without any rounding
+		for (int texel{}; texel < size; ++texel)
+		{
+			const float u = (texel + .5f) / size;
+			const float v = 1.f - u;
+
+			for (const float offset : { -1.f, 1.f, 2.f })
+			{
+				int x{}, y{};
+				TextureSampling::GetPointTexel(Vector2{ u + offset, v + offset }, size, size, AddressMode::Wrap, x, y);
+				isPassed = Check(x == texel && y == size - 1 - texel, "Point sample at uv + " + std::to_string(offset) + " doesn't wrap onto texel " + std::to_string(texel)) && isPassed;
+
+				TextureSampling::GetPointTexel(Vector2{ u + offset, v + offset }, size, size, AddressMode::Clamp, x, y);
+				const int clampedTexel = offset < 0.f ? 0 : size - 1;
+				isPassed = Check(x == clampedTexel && y == clampedTexel, "Point sample at uv + " + std::to_string(offset) + " isn't clamped to the edge") && isPassed;
+			}
+		}
+
+		// On the right edge the bilinear footprint wraps its second column around to the first, or repeats the last one when clamped
+		const Vector2 edgeUV{ 1.f, .5f };
+
+		const TextureSampling::BilinearFootprint wrapped = TextureSampling::GetBilinearFootprint(edgeUV, size, size, AddressMode::Wrap);
+		isPassed = Check(wrapped.x[0] == size - 1 && wrapped.x[1] == 0, "Wrapped footprint on the right edge doesn't span the last and first column") && isPassed;
+
+		const TextureSampling::BilinearFootprint clamped = TextureSampling::GetBilinearFootprint(edgeUV, size, size, AddressMode::Clamp);
+		isPassed = Check(clamped.x[0] == size - 1 && clamped.x[1] == size - 1, "Clamped footprint on the right edge leaves the last column") && isPassed;
+
+		// Shifting uv by whole textures only moves the footprint when clamped
+		const TextureSampling::BilinearFootprint shifted = TextureSampling::GetBilinearFootprint(Vector2{ .3f + 1.f, .6f - 1.f }, size, size, AddressMode::Wrap);
+		const TextureSampling::BilinearFootprint original = TextureSampling::GetBilinearFootprint(Vector2{ .3f, .6f }, size, size, AddressMode::Wrap);
+		isPassed = Check(shifted.x[0] == original.x[0] && shifted.x[1] == original.x[1] && shifted.y[0] == original.y[0] && shifted.y[1] == original.y[1],
+			"Wrapped footprint of uv shifted by a whole texture lands on other texels") && isPassed;
+
+		return isPassed;
+	}
+
+	const Test Tests[]
+	{
+		{ "cluster_fill", TestClusterFill },
+		{ "material_bake", TestMaterialBake },
+		{ "texture_addressing", TestTextureAddressing },
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	int amountOfFailures{};
+	int amountOfRuns{};
+
+	for (const Test& test : Tests)
+	{
+		bool isSelected = argc < 2;
+		for (int arg{ 1 }; arg < argc; ++arg)
+		{
+			isSelected |= std::strcmp(argv[arg], test.name) == 0;
+		}
+
+		if (!isSelected)
+			continue;
+
+		std::cout << test.name << "\n";
+		const bool isPassed = test.function();
+		std::cout << (isPassed ? "  passed\n" : "  FAILED\n");
+
+		amountOfFailures += !isPassed;
+		++amountOfRuns;
+	}
+
+	if (amountOfRuns == 0)
+	{
+		std::cout << "No test matches the given names\n";
+		return 1;
+	}
+
+	return amountOfFailures;
+}
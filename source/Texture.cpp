@@ -1,50 +1,43 @@
 #include "Texture.h"
-#include "Vector2.h"
+#include "MaterialCache.h"
 #include <SDL_image.h>
 
-#include <stdexcept>
+#include <cstring>
+#include <utility>
 
 namespace dae
 {
-	Texture::Texture(SDL_Surface* pSurface) :
-		m_pSurface{ pSurface },
-		m_pSurfacePixels{ (uint32_t*)pSurface->pixels }
+	bool Texture::DecodeFile(const std::string& path, BakedTexture& texture)
 	{
-	}
+		SDL_Surface* pImageSurface = IMG_Load(path.data());
+		if (pImageSurface == NULL)
+		{
+			return false;
+		}
 
-	Texture::~Texture()
-	{
-		if (m_pSurface)
+		// ABGR8888 is packed with red in the lowest byte, the layout of a baked texel
+		SDL_Surface* pTexelSurface = SDL_ConvertSurfaceFormat(pImageSurface, SDL_PIXELFORMAT_ABGR8888, 0);
+		SDL_FreeSurface(pImageSurface);
+
+		if (pTexelSurface == NULL)
 		{
-			SDL_FreeSurface(m_pSurface);
-			m_pSurface = nullptr;
+			return false;
 		}
-	}
 
-	Texture* Texture::LoadFromFile(const std::string& path)
-	{
-		SDL_Surface* pTextureSurface = IMG_Load(path.data());
-		if (pTextureSurface == NULL)
+		BakedTexture::MipLevel level{};
+		level.width = pTexelSurface->w;
+		level.height = pTexelSurface->h;
+		level.texels.resize(size_t(level.width) * level.height);
+
+		for (int y{}; y < level.height; ++y)
 		{
-			throw std::runtime_error("Error, texture file not found");
+			std::memcpy(level.texels.data() + size_t(y) * level.width, static_cast<const uint8_t*>(pTexelSurface->pixels) + y * pTexelSurface->pitch, level.width * sizeof(uint32_t));
 		}
 
-		return new Texture(pTextureSurface);
-	}
+		SDL_FreeSurface(pTexelSurface);
 
-	ColorRGB Texture::Sample(const Vector2& uv) const
-	{
-		const int16_t pixelX = m_pSurface->w * uv.x;
-		const int16_t pixelY = m_pSurface->h * uv.y;
-		const int32_t pixelIndex = pixelY * m_pSurface->w + pixelX;
-
-		uint8_t r{}, g{}, b{};
-		SDL_GetRGB(m_pSurfacePixels[pixelIndex], m_pSurface->format, &r, &g, &b);
-
-		return{
-			(float)r / 255.f,
-			(float)g / 255.f,
-			(float)b / 255.f
-		};
+		texture.mipLevels.clear();
+		texture.mipLevels.push_back(std::move(level));
+		return true;
 	}
-}
\ No newline at end of file
+}
@@ -1,24 +1,15 @@
 #pragma once
-#include <SDL_surface.h>
 #include <string>
-#include "ColorRGB.h"
 
 namespace dae
 {
-	struct Vector2;
+	struct BakedTexture;
 
-	class Texture
+	// Image decoding through SDL_image, the only part of texture loading that needs it. Everything the renderer samples
+	// is baked from the decoded texels, see MaterialCache
+	namespace Texture
 	{
-	public:
-		~Texture();
-
-		static Texture* LoadFromFile(const std::string& path);
-		ColorRGB Sample(const Vector2& uv) const;
-
-	private:
-		Texture(SDL_Surface* pSurface);
-
-		SDL_Surface* m_pSurface{ nullptr };
-		uint32_t* m_pSurfacePixels{ nullptr };
-	};
-}
\ No newline at end of file
+		// Decodes an image into RGBA8 texels, only mip level 0 is filled
+		bool DecodeFile(const std::string& path, BakedTexture& texture);
+	}
+}
@@ -0,0 +1,203 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <emmintrin.h>
+#include "Vector2.h"
+
+namespace dae
+{
+	// Addressing shared by the texture types, the math behind Sample that doesn't depend on what a texel holds
+	namespace TextureSampling
+	{
+		// How the texels of a mip level are ordered in memory
+		enum class TexelLayout
+		{
+			// Row after row
+			Linear,
+			// Tiles of 4x4 texels row after row, each tile row major. Neighbours along y mostly share a cache line,
+			// so walking the texture at an angle misses about as often as walking along its rows
+			Tiled,
+		};
+
+		constexpr int TileShift{ 2 };
+		constexpr int TileSize{ 1 << TileShift };
+		constexpr int TileMask{ TileSize - 1 };
+
+		// Texels a level takes in memory, tiled levels are padded to whole tiles
+		inline size_t GetLevelSize(int width, int height, TexelLayout layout)
+		{
+			if (layout == TexelLayout::Linear)
+			{
+				return size_t(width) * height;
+			}
+
+			return size_t((width + TileMask) >> TileShift) * size_t((height + TileMask) >> TileShift) * TileSize * TileSize;
+		}
+
+		// Offset of texel (x, y) from the start of its level
+		inline size_t GetTexelIndex(int x, int y, int width, TexelLayout layout)
+		{
+			if (layout == TexelLayout::Linear)
+			{
+				return size_t(y) * width + x;
+			}
+
+			const size_t tilesPerRow = size_t((width + TileMask) >> TileShift);
+			const size_t tile = size_t(y >> TileShift) * tilesPerRow + size_t(x >> TileShift);
+			return (tile << (2 * TileShift)) + size_t(((y & TileMask) << TileShift) + (x & TileMask));
+		}
+
+		// Copies row major texels into a level of the given layout
+		template<typename Texel>
+		void StoreLevel(const Texel* pRowMajor, int width, int height, TexelLayout layout, Texel* pLevel)
+		{
+			for (int y{}; y < height; ++y)
+			{
+				for (int x{}; x < width; ++x)
+				{
+					pLevel[GetTexelIndex(x, y, width, layout)] = pRowMajor[size_t(y) * width + x];
+				}
+			}
+		}
+
+		enum class Filter
+		{
+			Point,
+			Bilinear,
+		};
+
+		// What happens to texel coordinates outside of the texture
+		enum class AddressMode
+		{
+			Clamp,
+			Wrap,
+		};
+
+		struct SamplerState
+		{
+			Filter filter{ Filter::Bilinear };
+			AddressMode addressMode{ AddressMode::Clamp };
+		};
+
+		inline int ApplyAddressMode(int coordinate, int size, AddressMode addressMode)
+		{
+			if (addressMode == AddressMode::Wrap)
+			{
+				const int wrapped = coordinate % size;
+				return wrapped < 0 ? wrapped + size : wrapped;
+			}
+
+			return std::clamp(coordinate, 0, size - 1);
+		}
+
+		// The texel under uv
+		inline void GetPointTexel(const Vector2& uv, int width, int height, AddressMode addressMode, int& x, int& y)
+		{
+			x = ApplyAddressMode(int(std::floor(uv.x * width)), width, addressMode);
+			y = ApplyAddressMode(int(std::floor(uv.y * height)), height, addressMode);
+		}
+
+		// The 2x2 texels around uv and their weights in 1/256ths, which add up to 256
+		struct BilinearFootprint
+		{
+			int x[2]{};
+			int y[2]{};
+			// (x0, y0), (x1, y0), (x0, y1), (x1, y1)
+			uint16_t weights[4]{};
+		};
+
+		inline BilinearFootprint GetBilinearFootprint(const Vector2& uv, int width, int height, AddressMode addressMode)
+		{
+			// Texel centers sit at half texel offsets
+			const float texelX = uv.x * width - .5f;
+			const float texelY = uv.y * height - .5f;
+			const float floorX = std::floor(texelX);
+			const float floorY = std::floor(texelY);
+
+			const int fractionX = int((texelX - floorX) * 256.f);
+			const int fractionY = int((texelY - floorY) * 256.f);
+
+			BilinearFootprint footprint{};
+			footprint.x[0] = ApplyAddressMode(int(floorX), width, addressMode);
+			footprint.x[1] = ApplyAddressMode(int(floorX) + 1, width, addressMode);
+			footprint.y[0] = ApplyAddressMode(int(floorY), height, addressMode);
+			footprint.y[1] = ApplyAddressMode(int(floorY) + 1, height, addressMode);
+
+			// Rounded so the four still add up to exactly 256
+			const int weight11 = (fractionX * fractionY + 128) >> 8;
+			const int weight10 = fractionX - weight11;
+			const int weight01 = fractionY - weight11;
+			footprint.weights[0] = uint16_t(256 - weight10 - weight01 - weight11);
+			footprint.weights[1] = uint16_t(weight10);
+			footprint.weights[2] = uint16_t(weight01);
+			footprint.weights[3] = uint16_t(weight11);
+
+			return footprint;
+		}
+
+		// Weighted sum of 4 texels of 8 bytes each, every byte blended on its own in 16 bit lanes.
+		// A byte times a weight fits 16 bits and so does the sum, since the weights add up to 256
+		inline uint64_t BlendTexels(const uint64_t texels[4], const uint16_t weights[4])
+		{
+			const __m128i zero = _mm_setzero_si128();
+
+			__m128i sum = _mm_set1_epi16(128);
+			for (int index{}; index < 4; ++index)
+			{
+				const __m128i texel = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&texels[index])), zero);
+				sum = _mm_add_epi16(sum, _mm_mullo_epi16(texel, _mm_set1_epi16(short(weights[index]))));
+			}
+
+			const __m128i blended = _mm_packus_epi16(_mm_srli_epi16(sum, 8), zero);
+
+			uint64_t result{};
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(&result), blended);
+			return result;
+		}
+
+		// The same for 4 byte texels, two of them share a register
+		inline uint32_t BlendTexels(const uint32_t texels[4], const uint16_t weights[4])
+		{
+			const __m128i zero = _mm_setzero_si128();
+
+			const __m128i top = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(int(texels[0])), _mm_cvtsi32_si128(int(texels[1]))), zero);
+			const __m128i bottom = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(int(texels[2])), _mm_cvtsi32_si128(int(texels[3]))), zero);
+			const __m128i topWeights = _mm_set_epi16(short(weights[1]), short(weights[1]), short(weights[1]), short(weights[1]),
+				short(weights[0]), short(weights[0]), short(weights[0]), short(weights[0]));
+			const __m128i bottomWeights = _mm_set_epi16(short(weights[3]), short(weights[3]), short(weights[3]), short(weights[3]),
+				short(weights[2]), short(weights[2]), short(weights[2]), short(weights[2]));
+
+			// Both texels of a row in one register, then the upper half is added onto the lower one
+			__m128i sum = _mm_add_epi16(_mm_mullo_epi16(top, topWeights), _mm_mullo_epi16(bottom, bottomWeights));
+			sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+			sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+
+			return uint32_t(_mm_cvtsi128_si32(_mm_packus_epi16(_mm_srli_epi16(sum, 8), zero)));
+		}
+
+		// Level of detail of a pixel, from its uv derivatives along x and y and the size of level 0: log2 of its footprint in texels,
+		// clamped to the mip chain. The integer part is the finer of the two levels around the footprint, the fraction how far it is
+		// towards the coarser one
+		inline float ComputeLevelOfDetail(const Vector2& ddx, const Vector2& ddy, int width, int height, int amountOfLevels)
+		{
+			const float footprintX = (ddx.x * width) * (ddx.x * width) + (ddx.y * height) * (ddx.y * height);
+			const float footprintY = (ddy.x * width) * (ddy.x * width) + (ddy.y * height) * (ddy.y * height);
+			const float squaredFootprint = std::max(footprintX, footprintY);
+
+			// Magnified, also keeps NaN derivatives of a degenerate pixel on level 0
+			if (!(squaredFootprint > 1.f))
+			{
+				return 0.f;
+			}
+
+			return std::min(.5f * std::log2(squaredFootprint), float(amountOfLevels - 1));
+		}
+
+		// Blend weight of the coarser level in 1/256ths, 0 when the finer level alone is close enough
+		inline uint16_t GetLevelWeight(float levelOfDetail)
+		{
+			return uint16_t((levelOfDetail - std::floor(levelOfDetail)) * 256.f);
+		}
+	}
+}
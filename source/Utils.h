@@ -1,175 +1,378 @@
 #pragma once
 #include <cassert>
-#include <fstream>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include "Math.h"
 #include "DataTypes.h"
-
-//#define DISABLE_OBJ
+#include "MappedFile.h"
+#include "Parallel.h"
 
 namespace dae
 {
 	namespace Utils
 	{
-		//Just parses vertices and indices
+		// The position, uv and normal index of one face corner, 0 when the attribute is missing
+		struct ObjVertexKey
+		{
+			size_t position{};
+			size_t texCoord{};
+			size_t normal{};
+
+			bool operator==(const ObjVertexKey& other) const
+			{
+				return position == other.position && texCoord == other.texCoord && normal == other.normal;
+			}
+		};
+
+		struct ObjVertexKeyHash
+		{
+			size_t operator()(const ObjVertexKey& key) const
+			{
+				size_t hash = std::hash<size_t>{}(key.position);
+				hash ^= std::hash<size_t>{}(key.texCoord) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				hash ^= std::hash<size_t>{}(key.normal) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				return hash;
+			}
+		};
+
 #pragma warning(push)
 #pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding = true)
+		// Shared by both OBJ parsers once all faces are read. Every triangle computes its tangent in parallel,
+		// then every vertex sums the tangents of its triangles in triangle order, like a serial loop would
+		static void FinalizeOBJVertices(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, bool flipAxisAndWinding)
 		{
-#ifdef DISABLE_OBJ
+			const uint32_t amountOfTriangles = uint32_t(indices.size() / 3);
+			const uint32_t amountOfVertices = uint32_t(vertices.size());
+
+			//Cheap Tangent Calculations
+			std::vector<Vector3> triangleTangents(amountOfTriangles);
+			ParallelFor(0u, amountOfTriangles, [&](uint32_t triangle)
+			{
+				const uint32_t index0 = indices[3 * size_t(triangle)];
+				const uint32_t index1 = indices[3 * size_t(triangle) + 1];
+				const uint32_t index2 = indices[3 * size_t(triangle) + 2];
+
+				const Vector3& p0 = vertices[index0].position;
+				const Vector3& p1 = vertices[index1].position;
+				const Vector3& p2 = vertices[index2].position;
+				const Vector2& uv0 = vertices[index0].uv;
+				const Vector2& uv1 = vertices[index1].uv;
+				const Vector2& uv2 = vertices[index2].uv;
 
-			//TODO: Enable the code below after uncommenting all the vertex attributes of DataTypes::Vertex
-			// >> Comment/Remove '#define DISABLE_OBJ'
-			assert(false && "OBJ PARSER not enabled! Check the comments in Utils::ParseOBJ");
+				const Vector3 edge0 = p1 - p0;
+				const Vector3 edge1 = p2 - p0;
+				const Vector2 diffX = Vector2(uv1.x - uv0.x, uv2.x - uv0.x);
+				const Vector2 diffY = Vector2(uv1.y - uv0.y, uv2.y - uv0.y);
+				float r = 1.f / Vector2::Cross(diffX, diffY);
 
-#else
+				triangleTangents[triangle] = (edge0 * diffY.y - edge1 * diffY.x) * r;
+			});
 
-			std::ifstream file(filename);
-			if (!file)
-				return false;
+			// Triangles around every vertex, in ascending order: the corners of vertex v are [firstCorner[v], firstCorner[v + 1])
+			std::vector<uint32_t> firstCorner(size_t(amountOfVertices) + 1);
+			for (const uint32_t index : indices)
+			{
+				++firstCorner[size_t(index) + 1];
+			}
+
+			for (uint32_t vertex{}; vertex < amountOfVertices; ++vertex)
+			{
+				firstCorner[size_t(vertex) + 1] += firstCorner[vertex];
+			}
+
+			std::vector<uint32_t> cornerTriangles(indices.size());
+			std::vector<uint32_t> nextCorner(firstCorner.begin(), firstCorner.end() - 1);
+			for (size_t corner{}; corner < indices.size(); ++corner)
+			{
+				cornerTriangles[nextCorner[indices[corner]]++] = uint32_t(corner / 3);
+			}
+
+			//Fix the tangents per vertex now because we accumulated
+			ParallelFor(0u, amountOfVertices, [&](uint32_t vertex)
+			{
+				Vertex& v = vertices[vertex];
+
+				for (uint32_t corner{ firstCorner[vertex] }; corner < firstCorner[size_t(vertex) + 1]; ++corner)
+				{
+					v.tangent += triangleTangents[cornerTriangles[corner]];
+				}
+
+				v.tangent = Vector3::Reject(v.tangent, v.normal).Normalized();
+
+				if (flipAxisAndWinding)
+				{
+					v.position.z *= -1.f;
+					v.normal.z *= -1.f;
+					v.tangent.z *= -1.f;
+				}
+			});
+		}
+
+		// Scanning helpers for ParseOBJ, they never read past the end of the line they are given
+		namespace ObjScanner
+		{
+			inline const char* SkipSpaces(const char* pCurrent, const char* pEnd)
+			{
+				while (pCurrent < pEnd && (*pCurrent == ' ' || *pCurrent == '\t' || *pCurrent == '\r'))
+				{
+					++pCurrent;
+				}
+
+				return pCurrent;
+			}
+
+			// Returns nullptr when there is no number
+			inline const char* ParseFloat(const char* pCurrent, const char* pEnd, float& value)
+			{
+				pCurrent = SkipSpaces(pCurrent, pEnd);
+
+				// from_chars doesn't accept a leading plus sign
+				if (pCurrent < pEnd && *pCurrent == '+')
+				{
+					++pCurrent;
+				}
+
+				const auto [pNext, error] = std::from_chars(pCurrent, pEnd, value);
+				return error == std::errc{} ? pNext : nullptr;
+			}
+
+			// Returns nullptr when there is no number
+			inline const char* ParseIndex(const char* pCurrent, const char* pEnd, size_t& value)
+			{
+				const auto [pNext, error] = std::from_chars(pCurrent, pEnd, value);
+				return error == std::errc{} ? pNext : nullptr;
+			}
+		}
 
+		// Records of one line aligned range of an OBJ file
+		struct ObjChunk
+		{
 			std::vector<Vector3> positions{};
 			std::vector<Vector3> normals{};
 			std::vector<Vector2> UVs{};
 
-			vertices.clear();
-			indices.clear();
+			// Face corners in file order, the OBJ indices are absolute so they don't depend on the chunk
+			std::vector<ObjVertexKey> corners{};
+
+			bool isValid{ true };
+		};
 
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
+		// Parses every line in [pCurrent, pEnd), pCurrent has to be the start of a line
+		static void ParseOBJChunk(const char* pCurrent, const char* pEnd, ObjChunk& chunk)
+		{
+			while (pCurrent < pEnd)
 			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
+				const char* pLineEnd = static_cast<const char*>(std::memchr(pCurrent, '\n', pEnd - pCurrent));
+				if (!pLineEnd)
 				{
-					// Ignore Comment
+					pLineEnd = pEnd;
 				}
-				else if (sCommand == "v")
+
+				const char* pLine = ObjScanner::SkipSpaces(pCurrent, pLineEnd);
+				pCurrent = pLineEnd + 1;
+
+				const char* pCommandEnd = pLine;
+				while (pCommandEnd < pLineEnd && *pCommandEnd != ' ' && *pCommandEnd != '\t' && *pCommandEnd != '\r')
+				{
+					++pCommandEnd;
+				}
+
+				const std::string_view command{ pLine, size_t(pCommandEnd - pLine) };
+				pLine = pCommandEnd;
+
+				if (command == "v" || command == "vn")
 				{
-					//Vertex
 					float x, y, z;
-					file >> x >> y >> z;
+					pLine = ObjScanner::ParseFloat(pLine, pLineEnd, x);
+					pLine = pLine ? ObjScanner::ParseFloat(pLine, pLineEnd, y) : nullptr;
+					pLine = pLine ? ObjScanner::ParseFloat(pLine, pLineEnd, z) : nullptr;
+					if (!pLine)
+					{
+						chunk.isValid = false;
+						return;
+					}
 
-					positions.emplace_back(x, y, z);
+					if (command == "v")
+						chunk.positions.emplace_back(x, y, z);
+					else
+						chunk.normals.emplace_back(x, y, z);
 				}
-				else if (sCommand == "vt")
+				else if (command == "vt")
 				{
-					// Vertex TexCoord
 					float u, v;
-					file >> u >> v;
-					UVs.emplace_back(u, 1 - v);
-				}
-				else if (sCommand == "vn")
-				{
-					// Vertex Normal
-					float x, y, z;
-					file >> x >> y >> z;
+					pLine = ObjScanner::ParseFloat(pLine, pLineEnd, u);
+					pLine = pLine ? ObjScanner::ParseFloat(pLine, pLineEnd, v) : nullptr;
+					if (!pLine)
+					{
+						chunk.isValid = false;
+						return;
+					}
 
-					normals.emplace_back(x, y, z);
+					chunk.UVs.emplace_back(u, 1 - v);
 				}
-				else if (sCommand == "f")
+				else if (command == "f")
 				{
-					//if a face is read:
-					//construct the 3 vertices, add them to the vertex array
-					//add three indices to the index array
-					//add the material index as attibute to the attribute array
-					//
-					// Faces or triangles
-					Vertex vertex{};
-					size_t iPosition, iTexCoord, iNormal;
-
-					uint32_t tempIndices[3];
 					for (size_t iFace = 0; iFace < 3; iFace++)
 					{
-						// OBJ format uses 1-based arrays
-						file >> iPosition;
-						vertex.position = positions[iPosition - 1];
+						ObjVertexKey corner{};
+
+						// OBJ format uses 1-based arrays, 0 means the attribute is missing.
+						// Upper bounds are checked once all chunks are parsed
+						pLine = ObjScanner::ParseIndex(ObjScanner::SkipSpaces(pLine, pLineEnd), pLineEnd, corner.position);
+						if (!pLine || corner.position == 0)
+						{
+							chunk.isValid = false;
+							return;
+						}
 
-						if ('/' == file.peek())//is next in buffer ==  '/' ?
+						if (pLine < pLineEnd && *pLine == '/')
 						{
-							file.ignore();//read and ignore one element ('/')
+							++pLine;
 
-							if ('/' != file.peek())
+							if (pLine < pLineEnd && *pLine != '/')
 							{
 								// Optional texture coordinate
-								file >> iTexCoord;
-								vertex.uv = UVs[iTexCoord - 1];
+								pLine = ObjScanner::ParseIndex(pLine, pLineEnd, corner.texCoord);
 							}
 
-							if ('/' == file.peek())
+							if (pLine && pLine < pLineEnd && *pLine == '/')
 							{
-								file.ignore();
+								++pLine;
 
 								// Optional vertex normal
-								file >> iNormal;
-								vertex.normal = normals[iNormal - 1];
+								pLine = ObjScanner::ParseIndex(pLine, pLineEnd, corner.normal);
 							}
-						}
 
-						vertices.push_back(vertex);
-						tempIndices[iFace] = uint32_t(vertices.size()) - 1;
-						//indices.push_back(uint32_t(vertices.size()) - 1);
-					}
+							if (!pLine)
+							{
+								chunk.isValid = false;
+								return;
+							}
+						}
 
-					indices.push_back(tempIndices[0]);
-					if (flipAxisAndWinding) 
-					{
-						indices.push_back(tempIndices[2]);
-						indices.push_back(tempIndices[1]);
-					}
-					else
-					{
-						indices.push_back(tempIndices[1]);
-						indices.push_back(tempIndices[2]);
+						chunk.corners.push_back(corner);
 					}
 				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
+
+				// Everything else (comments, groups, materials) is ignored
 			}
+		}
 
-			//Cheap Tangent Calculations
-			for (uint32_t i = 0; i < indices.size(); i += 3)
+		// Parses vertices and indices straight out of the mapped file, returns false when the file can't be read or is malformed.
+		// The file is split in line aligned chunks that are parsed in parallel and stitched back together in file order,
+		// so the result is the same for any amount of threads
+		static bool ParseOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding = true)
+		{
+			const MappedFile file{ filename };
+			if (!file.IsOpen())
+				return false;
+
+			vertices.clear();
+			indices.clear();
+
+			const char* const pFileStart = file.GetData();
+			const char* const pFileEnd = pFileStart + file.GetSize();
+
+			// A few chunks per core so uneven chunks balance out, but not so small that the bookkeeping dominates
+			constexpr size_t minChunkSize{ 64 * 1024 };
+			const size_t maxAmountOfChunks = std::max(size_t(std::thread::hardware_concurrency()) * 4, size_t(1));
+			const size_t amountOfChunks = std::clamp(file.GetSize() / minChunkSize, size_t(1), maxAmountOfChunks);
+
+			// Chunk c covers [chunkStarts[c], chunkStarts[c + 1]), every boundary is moved forward to the start of a line
+			std::vector<const char*> chunkStarts(amountOfChunks + 1, pFileEnd);
+			chunkStarts[0] = pFileStart;
+			for (size_t chunk{ 1 }; chunk < amountOfChunks; ++chunk)
 			{
-				uint32_t index0 = indices[i];
-				uint32_t index1 = indices[size_t(i) + 1];
-				uint32_t index2 = indices[size_t(i) + 2];
+				const char* pSplit = std::max(pFileStart + file.GetSize() * chunk / amountOfChunks, chunkStarts[chunk - 1]);
+				const char* pNewLine = static_cast<const char*>(std::memchr(pSplit, '\n', pFileEnd - pSplit));
+				chunkStarts[chunk] = pNewLine ? pNewLine + 1 : pFileEnd;
+			}
 
-				const Vector3& p0 = vertices[index0].position;
-				const Vector3& p1 = vertices[index1].position;
-				const Vector3& p2 = vertices[index2].position;
-				const Vector2& uv0 = vertices[index0].uv;
-				const Vector2& uv1 = vertices[index1].uv;
-				const Vector2& uv2 = vertices[index2].uv;
+			std::vector<ObjChunk> chunks(amountOfChunks);
+			ParallelFor(size_t(0), amountOfChunks, [&](size_t chunk)
+			{
+				ParseOBJChunk(chunkStarts[chunk], chunkStarts[chunk + 1], chunks[chunk]);
+			});
 
-				const Vector3 edge0 = p1 - p0;
-				const Vector3 edge1 = p2 - p0;
-				const Vector2 diffX = Vector2(uv1.x - uv0.x, uv2.x - uv0.x);
-				const Vector2 diffY = Vector2(uv1.y - uv0.y, uv2.y - uv0.y);
-				float r = 1.f / Vector2::Cross(diffX, diffY);
+			// Prefix sums give every chunk the offset of its records in the stitched arrays
+			struct ChunkOffsets
+			{
+				size_t position{};
+				size_t normal{};
+				size_t UV{};
+				size_t corner{};
+			};
 
-				Vector3 tangent = (edge0 * diffY.y - edge1 * diffY.x) * r;
-				vertices[index0].tangent += tangent;
-				vertices[index1].tangent += tangent;
-				vertices[index2].tangent += tangent;
+			std::vector<ChunkOffsets> offsets(amountOfChunks + 1);
+			for (size_t chunk{}; chunk < amountOfChunks; ++chunk)
+			{
+				if (!chunks[chunk].isValid)
+					return false;
+
+				offsets[chunk + 1].position = offsets[chunk].position + chunks[chunk].positions.size();
+				offsets[chunk + 1].normal = offsets[chunk].normal + chunks[chunk].normals.size();
+				offsets[chunk + 1].UV = offsets[chunk].UV + chunks[chunk].UVs.size();
+				offsets[chunk + 1].corner = offsets[chunk].corner + chunks[chunk].corners.size();
 			}
 
-			//Fix the tangents per vertex now because we accumulated
-			for (auto& v : vertices)
+			const ChunkOffsets& totals = offsets[amountOfChunks];
+
+			std::vector<Vector3> positions(totals.position);
+			std::vector<Vector3> normals(totals.normal);
+			std::vector<Vector2> UVs(totals.UV);
+			std::vector<ObjVertexKey> corners(totals.corner);
+
+			ParallelFor(size_t(0), amountOfChunks, [&](size_t chunk)
 			{
-				v.tangent = Vector3::Reject(v.tangent, v.normal).Normalized();
+				const ObjChunk& source = chunks[chunk];
+				std::copy(source.positions.begin(), source.positions.end(), positions.begin() + offsets[chunk].position);
+				std::copy(source.normals.begin(), source.normals.end(), normals.begin() + offsets[chunk].normal);
+				std::copy(source.UVs.begin(), source.UVs.end(), UVs.begin() + offsets[chunk].UV);
+				std::copy(source.corners.begin(), source.corners.end(), corners.begin() + offsets[chunk].corner);
+			});
+
+			// Face corners that share all three indices share one vertex. Serial, so vertices keep the order of first use
+			std::unordered_map<ObjVertexKey, uint32_t, ObjVertexKeyHash> vertexLookup{};
+			std::vector<ObjVertexKey> uniqueCorners{};
+
+			// Where the n-th corner of a face ends up in the index buffer
+			const size_t cornerSlots[3]{ 0, flipAxisAndWinding ? 2u : 1u, flipAxisAndWinding ? 1u : 2u };
+
+			indices.resize(corners.size());
+			for (size_t corner{}; corner < corners.size(); ++corner)
+			{
+				const ObjVertexKey& key = corners[corner];
+				if (key.position > positions.size() || key.texCoord > UVs.size() || key.normal > normals.size())
+					return false;
 
-				if(flipAxisAndWinding)
+				const auto [it, isNewVertex] = vertexLookup.try_emplace(key, uint32_t(uniqueCorners.size()));
+				if (isNewVertex)
 				{
-					v.position.z *= -1.f;
-					v.normal.z *= -1.f;
-					v.tangent.z *= -1.f;
+					uniqueCorners.push_back(key);
 				}
 
+				indices[corner - corner % 3 + cornerSlots[corner % 3]] = it->second;
 			}
 
+			vertices.resize(uniqueCorners.size());
+			ParallelFor(size_t(0), uniqueCorners.size(), [&](size_t vertex)
+			{
+				const ObjVertexKey& key = uniqueCorners[vertex];
+				vertices[vertex].position = positions[key.position - 1];
+
+				if (key.texCoord != 0)
+					vertices[vertex].uv = UVs[key.texCoord - 1];
+
+				if (key.normal != 0)
+					vertices[vertex].normal = normals[key.normal - 1];
+			});
+
+			FinalizeOBJVertices(vertices, indices, flipAxisAndWinding);
+
 			return true;
-#endif
 		}
 
 		inline static float Remap(float depthValue, float min, float max)
@@ -0,0 +1,40 @@
+#include "VertexStream.h"
+
+//Project includes
+#include "DataTypes.h"
+
+namespace dae
+{
+	void VertexStream::Assign(const std::vector<Vertex>& vertices)
+	{
+		amountOfVertices = vertices.size();
+		paddedAmountOfVertices = (amountOfVertices + VertexPadding - 1) / VertexPadding * VertexPadding;
+
+		components.assign(ENUM_LENGTH * paddedAmountOfVertices, 0.f);
+
+		float* pComponents[ENUM_LENGTH]{};
+		for (int component{}; component < ENUM_LENGTH; ++component)
+		{
+			pComponents[component] = components.data() + component * paddedAmountOfVertices;
+		}
+
+		for (size_t index{}; index < amountOfVertices; ++index)
+		{
+			const Vertex& vertex = vertices[index];
+			pComponents[PositionX][index] = vertex.position.x;
+			pComponents[PositionY][index] = vertex.position.y;
+			pComponents[PositionZ][index] = vertex.position.z;
+			pComponents[ColorR][index] = vertex.color.r;
+			pComponents[ColorG][index] = vertex.color.g;
+			pComponents[ColorB][index] = vertex.color.b;
+			pComponents[U][index] = vertex.uv.x;
+			pComponents[V][index] = vertex.uv.y;
+			pComponents[NormalX][index] = vertex.normal.x;
+			pComponents[NormalY][index] = vertex.normal.y;
+			pComponents[NormalZ][index] = vertex.normal.z;
+			pComponents[TangentX][index] = vertex.tangent.x;
+			pComponents[TangentY][index] = vertex.tangent.y;
+			pComponents[TangentZ][index] = vertex.tangent.z;
+		}
+	}
+}
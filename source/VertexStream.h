@@ -0,0 +1,41 @@
+#pragma once
+
+//Standard includes
+#include <cstddef>
+#include <vector>
+
+//Project includes
+#include "AlignedAllocator.h"
+
+namespace dae
+{
+	struct Vertex;
+
+	// The vertex attributes of a mesh as one array per component (structure of arrays), so the vertex stage can load
+	// the same component of 4 or 8 vertices with one aligned load. Vertex::viewDirection is only an output and isn't stored
+	struct VertexStream
+	{
+		enum Component
+		{
+			PositionX, PositionY, PositionZ,
+			ColorR, ColorG, ColorB,
+			U, V,
+			NormalX, NormalY, NormalZ,
+			TangentX, TangentY, TangentZ,
+			ENUM_LENGTH,
+		};
+
+		// Every component array starts on a 32 byte boundary and holds a multiple of 8 vertices, the padding is zero
+		static constexpr size_t Alignment{ 32 };
+		static constexpr size_t VertexPadding{ 8 };
+
+		size_t amountOfVertices{};
+		size_t paddedAmountOfVertices{};
+
+		std::vector<float, AlignedAllocator<float, Alignment>> components{};
+
+		const float* GetComponent(Component component) const { return components.data() + component * paddedAmountOfVertices; };
+
+		void Assign(const std::vector<Vertex>& vertices);
+	};
+}
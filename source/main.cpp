@@ -5,11 +5,14 @@
 #undef main
 
 //Standard includes
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
+#include "Benchmark.h"
 
 using namespace dae;
 
@@ -21,9 +24,17 @@ void ShutDown(SDL_Window* pWindow)
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	// Loader benchmark, runs without a window: Rasterizer --bench-obj <file.obj> [iterations]
+	if (argc >= 3 && std::string{ args[1] } == "--bench-obj")
+	{
+		return Benchmark::CompareOBJParsers(args[2], argc >= 4 ? std::atoi(args[3]) : 10);
+	}
+
+	// Texture layout benchmark: Rasterizer --bench-texture [iterations]
+	if (argc >= 2 && std::string{ args[1] } == "--bench-texture")
+	{
+		return Benchmark::CompareTextureLayouts(argc >= 3 ? std::atoi(args[2]) : 10);
+	}
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -81,6 +92,18 @@ int main(int argc, char* args[])
 				{
 					pRenderer->ToggleShadingCycle();
 				}
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+				{
+					pRenderer->ToggleCullMode();
+				}
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+				{
+					pRenderer->ToggleDeferredShading();
+				}
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+				{
+					pRenderer->ToggleTextureFiltering();
+				}
 
 				break;
 			}
@@ -90,7 +113,12 @@ int main(int argc, char* args[])
 		pRenderer->Update(pTimer);
 
 		//--------- Render ---------
-		pRenderer->Render();
+		if (!pRenderer->Render())
+		{
+			// Nothing changed, sleep until the next input instead of spinning. Capped at about a frame at 60Hz
+			// so the first frame after idling doesn't see a huge elapsed time
+			SDL_WaitEventTimeout(nullptr, 16);
+		}
 
 		//--------- Timer ---------
 		pTimer->Update();